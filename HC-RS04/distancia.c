@@ -10,6 +10,8 @@
  *
  *  - Utiliza o evento de captura do Timer para borda
  *    de subida e descida de uma porta.
+ *  - Pulso de trigger gerado pelo próprio Timer B1 (saída TB1.1 em
+ *    OUTMOD_3: sobe em CCR1 e desce em CCR0).
  *
  *                MSP430FR2355
  *            -----------------
@@ -18,7 +20,7 @@
  *         --|RST          XOUT|-
  *           |                 |
  *           |       P2.1/TB1.2| <-- Sensor / Echo1
- *           |             P2.4| <-- Sensor / Trig1
+ *           |       P2.0/TB1.1| --> Sensor / Trig1
  *           |                 |
  */
 
@@ -33,6 +35,14 @@
 #endif
 
 
+/* Frequência do Timer B1: SMCLK (24MHz) / 8 */
+#define SONAR_TIMER_FREQ (24000000UL / 8)
+
+/* Pulso de trigger: largura (10us) e atraso entre a programação e o
+ * início do pulso, em contagens do Timer B1 */
+#define TRIGGER_LARGURA ((SONAR_TIMER_FREQ / 1000000) * 10)
+#define TRIGGER_ATRASO  (8)
+
 volatile uint16_t distancia = 0;
 
 
@@ -55,24 +65,37 @@ void config_timerB_1(){
     TB1CTL |= TBSSEL_2 | MC_2 | TBCLR | ID_3;   // Duvida se esta certo ou se tem que por TB1.2...
 }
 
+/* Configura o pino do trigger: saída TB1.1 no P2.0, começa em
+ * nivel logico baixo (OUTMOD_0 com OUT = 0) */
+void init_trigger(){
+    TB1CCTL1 = OUTMOD_0;
+    P2DIR |= BIT0;
+    P2SEL0 |= BIT0;
+}
+
 /* Funcao para criar o trigger de acionamento do sensor.
- * Para isso coloca a sida do pino em nivel logico alto
- * por 10us e depois coloca o pino em nivel logico baixo. */
+ * O pulso de 10us é gerado pelo hardware na saída TB1.1 (P2.0):
+ * OUTMOD_3 (set/reset) sobe em TB1CCR1 e desce em TB1CCR0.
+ * A função retorna logo após programar o timer e a ISR do CCR0
+ * desliga a saída para o pulso não se repetir na próxima volta. */
 void trigger(){
 
-    /* Coloca a saida do pino P2.4 em nivel logico alto */
-    SET_BIT(P2OUT,BIT4);
+    uint16_t state = __get_interrupt_state();
+    uint16_t inicio;
 
-    /* Petriodo do trigger: Tt = 10*10^-6
-     * Periodo da CPU: Tcpu = 1/24*10^6
-     * Numero de ciclos = Tt/Tcpu
-     * Numero de ciclos = 10*10^-6/(1/24*10^6)
-     * Numero de ciclos = 240
-     * */
-    __delay_cycles(240);
+    /* Uma ISR entre a leitura de TB1R e a escrita de OUTMOD_3 poderia
+     * deixar CCR1 para trás: o pulso só sairia na próxima volta */
+    __disable_interrupt();
 
-    /* Coloca a saida do pino P2.4 em nivel logico baixo */
-    CLR_BIT(P2OUT,BIT4);
+    inicio = TB1R + TRIGGER_ATRASO;
+    TB1CCR1 = inicio;
+    TB1CCR0 = inicio + TRIGGER_LARGURA;
+    TB1CCTL0 = CCIE;
+
+    /* Dispara: uma escrita só */
+    TB1CCTL1 = OUTMOD_3;
+
+    __set_interrupt_state(state);
 }
 
 
@@ -89,7 +112,7 @@ uint32_t medicao_distancia(){
 #pragma vector = TIMER1_B1_VECTOR
 __interrupt void TIMER1_B1_ISR(void)
 #elif defined(__GNUC__)
-void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
+void __attribute__ ((interrupt(TIMER1_B1_VECTOR))) TIMER1_B1_ISR (void)
 #else
 #error Compiler not supported!
 #endif
@@ -100,7 +123,7 @@ void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
     uint16_t timer_count_0 = 0;
     uint16_t timer_count_1 = 0;
 
-    TB1CCTL0 &= ~CCIFG;
+    TB1CCTL2 &= ~CCIFG;
 
     /* ToDo: validar P2IN para detecção da borda */
 
@@ -119,3 +142,18 @@ void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
 }
 
 
+/* ISR0 do Timer B1: fim do pulso de trigger (comparação com TB1CCR0).
+ * A saída já desceu pelo hardware: aqui ela é desligada até o próximo
+ * trigger() */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER1_B0_VECTOR
+__interrupt void TIMER1_B0_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    TB1CCTL1 = OUTMOD_0;
+    TB1CCTL0 = 0;
+}
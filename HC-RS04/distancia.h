@@ -17,6 +17,7 @@
 
 void init_clock_system(void);
 void config_timerB_1();
+void init_trigger();
 void trigger();
 uint32_t medicao_distancia();
 
@@ -101,16 +101,13 @@ void main(void)
     volatile uint32_t distancia = 0;
 
 
-    /* Configura o pino P2.4 como saida
-     * Pino responsavel por receber o trigger imput
-     * para o sensor funcionar */
-    P2DIR = BIT4;
-    P2OUT = 0;   // Inicializa em nivel logico baixo
-
     /* Input capture for P2.1 */  // Ver se é assim mesmo
     P2SEL0 = BIT1;
     P2SEL1 = BIT1;
 
+    /* Trigger gerado pelo Timer B1 no P2.0 (TB1.1) */
+    init_trigger();
+
     __bis_SR_register(GIE);
 
     while(1)
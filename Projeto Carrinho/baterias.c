@@ -0,0 +1,160 @@
+/*
+ * baterias.c
+ *
+ * Nome: Laura Martin Werneck
+ *
+ * Data: 14 de jun de 2022
+ *
+ * Descrição: Módulo responsável pelas funções das baterias.
+ * Versão do carrinho da Tarefa 04: o Timer B1 é usado pelo sensor de
+ * distância, portanto as conversões são iniciadas por software
+ * (inicia_medicao_baterias) a cada tick da telemetria.
+ *
+ *                  MSP430FR2355
+ *               -----------------
+ *              |                 |
+ *              |         P1.1 A1 | <-- Bat1
+ *              |         P1.2 A2 | <-- Bat2
+ *              |                 |
+ */
+
+#include <msp430.h>
+
+/* Tipos uint16_t, uint8_t, ... */
+#include <stdint.h>
+
+#ifndef __MSP430FR2355__
+#error "Clock system not supported for this device"
+#endif
+
+#include "baterias.h"
+
+volatile uint16_t adc_data[2] = {0};   //Vetor de 16 bits sem sinal
+
+
+void init_adc(){
+
+    /* Configura pinos P1.1 e P1.2 como entrada do AD */
+    P1SEL0 |=  BIT1 + BIT2;                 // Configuracoes conforme a tabela do MSP430
+    P1SEL1 |=  BIT1 + BIT2;
+
+    /* 16ADCclks, ADC ON */
+    ADCCTL0 |= ADCSHT_2 | ADCON;   // Liga o ADC
+    /* ADC clock MODCLK, sampling timer, trigger por software (ADCSC),
+     * um canal e uma conversão por vez */
+    ADCCTL1 |= ADCSHP | ADCSHS_0 | ADCCONSEQ_0;
+    /* 8-bit conversion results */
+    ADCCTL2 &= ~ADCRES;
+    /* 12-bits conversion results */
+    ADCCTL2 |= ADCRES_2;                    //Configura como sendo de 12 bits
+
+    /* A1; Vref=3.3V */
+    ADCMCTL0 |= ADCINCH_1 | ADCSREF_0;
+    /* Enable ADC ISQ */
+    ADCIE |= ADCIE0;
+
+    /* Configure reference interna  */
+    PMMCTL0_H = PMMPW_H;                                        // Unlock the PMM registers
+    PMMCTL2 |= INTREFEN;                                        // Enable internal reference
+    __delay_cycles(400);                                        // Delay for reference settling
+}
+
+/* Inicia a conversão das duas baterias: A1 e depois A2 na ISR.
+ * Ignorado se a conversão anterior ainda não terminou. */
+void inicia_medicao_baterias(){
+
+    if (ADCCTL1 & ADCBUSY)
+        return;
+
+    ADCCTL0 |= ADCENC | ADCSC;
+}
+
+uint32_t medicao_bateria_1(){
+
+    volatile uint32_t tensao_bateria_1 = 0;
+
+    /* Calculo da tensão da bateria
+     * ADC = Vin*2¹²/Vref
+     * Vin = ADC*3,3*10/2¹²
+     * Vin = bat*1/3
+     * tensao_bateria = (ADC*3,3*10*3)/2¹²
+     * Tem o uint32_t antes do adc para tranformar ele em um número de 32 bits. */
+    tensao_bateria_1 = (uint32_t)adc_data[0]*3;
+    tensao_bateria_1 = (tensao_bateria_1*33) >> 12;
+
+    return tensao_bateria_1;
+
+}
+
+
+
+uint32_t medicao_bateria_2(){
+
+    volatile uint32_t tensao_bateria_2 = 0;
+
+    /* Calculo da tensão da bateria
+     * ADC = Vin*2¹²/Vref
+     * Vin = ADC*3,3*10/2¹²
+     * Vin = bat*2/3
+     * tensao_bateria = (ADC*3,3*10*3)/2¹²*2
+     * Tem o uint32_t antes do adc para tranformar ele em um número de 32 bits. */
+    tensao_bateria_2 = (uint32_t)adc_data[1]*3;
+    tensao_bateria_2 = (tensao_bateria_2*33) >> 13;
+
+    return tensao_bateria_2;
+
+}
+
+
+// ADC interrupt service routine
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=ADC_VECTOR
+__interrupt void ADC_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(ADC_VECTOR))) ADC_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    static uint8_t i = 0;
+
+    switch(__even_in_range(ADCIV,ADCIV_ADCIFG))
+    {
+        case ADCIV_NONE:
+            break;
+        case ADCIV_ADCOVIFG:
+            break;
+        case ADCIV_ADCTOVIFG:
+            break;
+        case ADCIV_ADCHIIFG:
+            break;
+        case ADCIV_ADCLOIFG:
+            break;
+        case ADCIV_ADCINIFG:
+            break;
+        case ADCIV_ADCIFG:
+
+            /* Obter amostras */
+            adc_data[i] = ADCMEM0;
+
+            /* Canal só pode ser trocado com ADCENC desligado */
+            ADCCTL0 &= ~ADCENC;
+            ADCMCTL0 &= ~ 0x03;          // Zera os dois ultimos bits
+
+            if(i == 0){
+                /* Converte a segunda bateria em seguida */
+                ADCMCTL0 |= ADCINCH_2 | ADCSREF_0;
+                ADCCTL0 |= ADCENC | ADCSC;
+            }
+            else
+                ADCMCTL0 |= ADCINCH_1 | ADCSREF_0;
+
+            i++;
+
+            i = i & 0x01;
+
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,21 @@
+/*
+ * baterias.h
+ *
+ *  Created on: 14 de jun de 2022
+ *      Author: Aluno
+ */
+
+#ifndef BATERIAS_H_
+#define BATERIAS_H_
+
+#include <stdint.h>
+
+void init_adc();
+
+void inicia_medicao_baterias();
+
+uint32_t medicao_bateria_1();
+uint32_t medicao_bateria_2();
+
+
+#endif /* BATERIAS_H_ */
@@ -10,6 +10,23 @@
  *
  *  - Utiliza o evento de captura do Timer para borda
  *    de subida e descida de uma porta.
+ *  - Pulso de trigger gerado pelo próprio Timer B1 (saída TB1.1 em
+ *    OUTMOD_3: sobe em CCR1 e desce em CCR0): largura exata mesmo com
+ *    outras ISRs e sem espera ocupada da CPU.
+ *  - Timer B1 estendido para 32 bits pelo contador de voltas (TBIFG):
+ *    a largura do eco é calculada por sonar.c sem erro de volta.
+ *  - Medições agendadas pelo comparador 0 do Timer B1, sem o main: o
+ *    próximo trigger sai assim que o eco termina (sonar_proximo), mais
+ *    rápido com obstáculos perto e lento com o caminho livre.
+ *  - O mesmo comparador encerra o eco que não termina (SONAR_TIMEOUT):
+ *    o main nunca espera por um eco que não vem.
+ *  - Até SONAR_SENSORES sensores, um por Timer B livre (TB0 é da UART e
+ *    TB3 dos motores), todos com o mesmo arranjo: TBx.1 trigger e TBx.2
+ *    eco. Os timers contam juntos (mesma base de tempo) e os sensores
+ *    disparam um de cada vez, em rodízio (sonar_rodizio).
+ *  - Com SONAR_VARREDURA o sensor 0 fica em um servo no Timer B2: a
+ *    cada medição o servo vai para o ângulo seguinte (varredura.c) e o
+ *    próximo disparo espera ele assentar.
  *
  *                MSP430FR2355
  *            -----------------
@@ -17,8 +34,10 @@
  *         | |                 |
  *         --|RST          XOUT|-
  *           |                 |
- *           |       P2.1/TB1.2| <-- Sensor / Echo1
- *           |             P2.4| <-- Sensor / Trig1
+ *           |       P2.1/TB1.2| <-- Sensor 0 / Echo1
+ *           |       P2.0/TB1.1| --> Sensor 0 / Trig1
+ *           |       P5.1/TB2.2| <-- Sensor 1 / Echo2 (SONAR_SENSORES 2)
+ *           |       P5.0/TB2.1| --> Sensor 1 / Trig2 ou servo (SONAR_VARREDURA)
  *           |                 |
  */
 
@@ -28,6 +47,12 @@
 #include "bits.h"
 #include "gpio.h"
 #include "hc_sr04.h"
+#include "sonar.h"
+#include "varredura.h"
+
+#if (COV != SONAR_CCTL_COV) || (CCI != SONAR_CCTL_CCI) || (CCIFG != SONAR_CCTL_CCIFG)
+#error "Bits de TBxCCTLn diferentes dos de sonar.h"
+#endif
 
 
 #ifndef __MSP430FR2355__
@@ -37,8 +62,65 @@
 #define LED2_PORT P6
 #define LED_2 BIT6
 
+/* Divisor dos Timers B1 e B2 (SONAR_DIVISOR em sonar.h) */
+#if SONAR_DIVISOR == 1
+#define SONAR_ID ID_0
+#elif SONAR_DIVISOR == 2
+#define SONAR_ID ID_1
+#elif SONAR_DIVISOR == 4
+#define SONAR_ID ID_2
+#elif SONAR_DIVISOR == 8
+#define SONAR_ID ID_3
+#else
+#error "SONAR_DIVISOR deve ser 1, 2, 4 ou 8"
+#endif
+
+#if SONAR_SENSORES < 1 || SONAR_SENSORES > 2
+#error "SONAR_SENSORES deve ser 1 (Timer B1) ou 2 (Timers B1 e B2)"
+#endif
+
+#if SONAR_VARREDURA && SONAR_SENSORES > 1
+#error "SONAR_VARREDURA usa o Timer B2 do segundo sensor"
+#endif
+
+/* Acesso aos registradores de um Timer B pelo endereço base: os
+ * deslocamentos são iguais em todas as instâncias */
+#define TIMER_REG(base, ofs) (*(volatile uint16_t *)(uintptr_t)((base) + (ofs)))
+#define OFS_TBxCTL   OFS_TB1CTL
+#define OFS_TBxCCTL0 OFS_TB1CCTL0
+#define OFS_TBxCCTL1 OFS_TB1CCTL1
+#define OFS_TBxCCTL2 OFS_TB1CCTL2
+#define OFS_TBxR     OFS_TB1R
+#define OFS_TBxCCR0  OFS_TB1CCR0
+#define OFS_TBxCCR1  OFS_TB1CCR1
+#define OFS_TBxCCR2  OFS_TB1CCR2
+#define OFS_TBxIV    OFS_TB1IV
+
+/* Timer de cada sensor */
+static const uint16_t sensor_timer[SONAR_SENSORES] = {
+    TIMER_B1_BASE,
+#if SONAR_SENSORES > 1
+    TIMER_B2_BASE,
+#endif
+};
+
+/* Estado da medição de cada sensor */
+static struct sonar_t sonar[SONAR_SENSORES];
 
-volatile uint16_t distancia = 0;
+/* Voltas de cada timer: 16 bits mais significativos do tempo */
+static volatile uint16_t voltas[SONAR_SENSORES];
+
+/* Agendamento: alterados somente com interrupções desabilitadas.
+ * ativo: sensor com o comparador 0 habilitado.
+ * agendamento: fase e próximo tempo do sensor ativo (sonar.c) */
+static uint8_t ativo = 0;
+static struct sonar_agenda_t agendamento = { SONAR_FASE_ESPERA, 0 };
+
+/* Geração da última amostra entregue por medicao_nova() */
+static uint16_t geracao_lida[SONAR_SENSORES];
+
+/* Quantidade de estouros do watchdog (~16ms cada): base de tempo do main */
+volatile uint16_t wdt_ticks = 0;
 
 /* Configura temporizador watchdog */
 void config_wd_as_timer(){
@@ -55,95 +137,317 @@ void config_wd_as_timer(){
     SFRIE1 |= WDTIE;
 }
 
-/* Configura temporizador B1.2 */
+/* Configura temporizador B1.2 (e B2.2 com dois sensores) */
 void config_timerB_1(){
-    /* Configura comparador 2 do timer B:
-     * CM_3: captura de borda de subida e descida
-     * CCIS_0: entrada A
-     * CCIE: ativa IRQ
-     * CAP: modo captura
-     * SCS: captura sÃ­ncrona
-     */
-    TB1CCTL2 |= CM_3 | CCIS_0 | CCIE | CAP | SCS;
+
+    uint8_t i;
+
+    for (i = 0; i < SONAR_SENSORES; i++){
+        /* Configura comparador 2 do timer B:
+         * CM_3: captura de borda de subida e descida
+         * CCIS_0: entrada A
+         * CCIE: ativa IRQ
+         * CAP: modo captura
+         * SCS: captura sÃ­ncrona
+         */
+        TIMER_REG(sensor_timer[i], OFS_TBxCCTL2) |= CM_3 | CCIS_0 | CCIE | CAP | SCS;
+        sonar_init(&sonar[i]);
+    }
 
     /* Configura timer B1.2:
      * TBSSEL_2: SMCLK como clock source
      * MC_2: modo de contagem contÃ­nua
      * TBCLR: limpa registrador de contagem
      * TBIE -> Habilitação de IRQ.
-     */
-    TB1CTL |= TBSSEL_2 | MC_2 | TBCLR | ID_3;
+     *
+     * Timer B2 iniciado em seguida: a diferença entre as contagens é de
+     * no máximo uma, os tempos dos sensores são comparáveis */
+    TB1CTL |= TBSSEL_2 | MC_2 | TBCLR | SONAR_ID | TBIE;
+#if SONAR_SENSORES > 1
+    TB2CTL |= TBSSEL_2 | MC_2 | TBCLR | SONAR_ID | TBIE;
+#endif
 }
 
-/* Funcao para criar o trigger de acionamento do sensor.
- * Para isso coloca a sida do pino em nivel logico alto
- * por 10us e depois coloca o pino em nivel logico baixo. */
-void trigger(){
+/* Tempo de 32 bits de uma captura do timer de um sensor (sonar_tempo).
+ * Com TBxR é o tempo atual (interrupções desabilitadas) */
+static inline uint32_t tempo_captura(uint8_t sensor, const uint16_t base, uint16_t ccr){
+
+    return sonar_tempo(voltas[sensor], (TIMER_REG(base, OFS_TBxCTL) & TBIFG) != 0, ccr);
+}
+
+/* Agenda o próximo disparo de um sensor. Interrupções desabilitadas: a
+ * ISR0 do timer do sensor é chamada logo em seguida e programa o pulso
+ * ou a espera. Só o comparador 0 do sensor ativo fica habilitado.
+ * Durante um pulso o agendamento é feito no fim do pulso */
+static void agenda(uint8_t sensor, uint32_t quando){
+
+    uint16_t base = sensor_timer[sensor];
+
+    if (!sonar_agenda(&agendamento, quando))
+        return;
+
+    TIMER_REG(sensor_timer[ativo], OFS_TBxCCTL0) = 0;
+
+    ativo = sensor;
+    TIMER_REG(base, OFS_TBxCCR0) = TIMER_REG(base, OFS_TBxR) + SONAR_TRIGGER_ATRASO;
+    TIMER_REG(base, OFS_TBxCCTL0) = CCIE;
+}
+
+/* Fim da medição de um sensor: agenda o próximo disparo. Na varredura
+ * o servo anda logo após o eco, durante o intervalo mínimo entre
+ * disparos, e o ritmo lento de sonar_proximo() não é usado: o mapa é
+ * atualizado sempre na velocidade máxima. Interrupções desabilitadas */
+static void proxima_medicao(uint8_t sensor, uint32_t agora){
 
-    /* Coloca a saida do pino P2.4 em nivel logico alto */
-    SET_BIT(P2OUT,BIT4);
+    uint32_t quando;
 
-    /* Petriodo do trigger: Tt = 10*10^-6
-     * Periodo da CPU: Tcpu = 1/24*10^6
-     * Numero de ciclos = Tt/Tcpu
-     * Numero de ciclos = 10*10^-6/(1/24*10^6)
-     * Numero de ciclos = 240
-     * */
-    __delay_cycles(240);
+#if SONAR_VARREDURA
+    uint32_t assentado;
 
-    /* Coloca a saida do pino P2.4 em nivel logico baixo */
-    CLR_BIT(P2OUT,BIT4);
+    assentado = varredura_passo(sonar[sensor].status == SONAR_INVALIDA ?
+                                SONAR_MM_INVALIDO : sonar_mm(sonar[sensor].largura), agora);
+    quando = sonar[sensor].disparo + SONAR_INTERVALO_MIN;
+    if ((int32_t)(assentado - quando) > 0)
+        quando = assentado;
+#else
+    (void)agora;
+    sensor = sonar_rodizio(sonar, SONAR_SENSORES, sensor, &quando);
+#endif
+
+    agenda(sensor, quando);
+}
+
+/* Funcao para criar o trigger de acionamento do sensor.
+ * O pulso de 10us é gerado pelo hardware na saída TBx.1 (P2.0 no
+ * sensor 0):
+ *
+ *  OUTMOD_3 (set/reset): sobe em TBxCCR1 e desce em TBxCCR0
+ *
+ *  TBxR   --+---------+--------------------------->
+ *           |         |
+ *         CCR1      CCR0 = CCR1 + SONAR_TRIGGER_LARGURA
+ *           +---------+
+ *  TBx.1    |         |
+ *       ----+         +----------------------------
+ *
+ * Os disparos seguintes são agendados pelas ISRs dos timers ao fim de
+ * cada eco: trigger() só antecipa a próxima medição (ex.: início). */
+void trigger(){
 
-    /* Fazer o timer resetar quando acontecer o trigger*/
-   TB1CTL |= TBCLR;
+    uint16_t state = __get_interrupt_state();
+    uint16_t base;
 
+    __disable_interrupt();
+    base = sensor_timer[ativo];
+    agenda(ativo, tempo_captura(ativo, base, TIMER_REG(base, OFS_TBxR)));
+    __set_interrupt_state(state);
 }
 
 void init_sensor(){
 
-    /* Configura o pino P2.4 como saida
-     * Pino responsavel por receber o trigger imput
-     * para o sensor funcionar */
-    P2DIR = BIT4;
-    P2OUT = 0;   // Inicializa em nivel logico baixo
+    uint8_t i;
 
-    /* Input capture for P2.1 */
-    P2SEL0 = BIT1;
+    /* Trigger: saída TBx.1, começa em nivel logico baixo
+     * (OUTMOD_0 com OUT = 0) */
+    for (i = 0; i < SONAR_SENSORES; i++)
+        TIMER_REG(sensor_timer[i], OFS_TBxCCTL1) = OUTMOD_0;
+
+    /* Input capture for P2.1
+     * Saída TB1.1 no P2.0 */
+    P2DIR |= BIT0;
+    P2SEL0 |= BIT0 | BIT1;
+
+#if SONAR_SENSORES > 1
+    /* Sensor 1: captura TB2.2 no P5.1, saída TB2.1 no P5.0 */
+    P5DIR |= BIT0;
+    P5SEL0 |= BIT0 | BIT1;
+#endif
 
     PORT_DIR(LED2_PORT) = LED_2;
     PORT_OUT(LED2_PORT) = 0;
+
+#if SONAR_VARREDURA
+    /* Servo no primeiro ângulo: a primeira medição espera ele chegar.
+     * As próximas são agendadas pelas ISRs */
+    varredura_init();
+    {
+        uint16_t state = __get_interrupt_state();
+
+        __disable_interrupt();
+        agenda(SENSOR_FRENTE, tempo_captura(SENSOR_FRENTE, TIMER_B1_BASE, TB1R) + VARREDURA_PARTIDA);
+        __set_interrupt_state(state);
+    }
+#else
+    /* Primeira medição: as próximas são agendadas pelas ISRs */
+    trigger();
+#endif
 }
 
 
-/* Funcao para retornar o calculo da distancia no main */
+/* Funcao para retornar o calculo da distancia no main:
+ * largura do último eco válido do sensor da frente em contagens do timer.
+ * As leituras usam a amostra publicada (sonar_le): sem desabilitar
+ * interrupções e sem misturar campos de medições diferentes */
 uint32_t medicao_distancia(){
-    return distancia;
+
+    struct sonar_amostra_t amostra;
+
+    sonar_le(&sonar[SENSOR_FRENTE], &amostra);
+
+    return amostra.largura;
 }
 
+/* Distância do último eco do sensor da frente em mm */
+uint16_t medicao_distancia_mm(){
+    return sonar_mm(medicao_distancia());
+}
 
-/* Timer1 Interrupt Handler
- * Interrupcao para obter o valor do comparador na
- * borda de subbida e na borda de descida*/
-#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
-#pragma vector = TIMER1_B1_VECTOR
-__interrupt void TIMER1_B1_ISR(void)
-#elif defined(__GNUC__)
-void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
-#else
-#error Compiler not supported!
-#endif
-{
+/* Distância filtrada (mediana sem outliers) em mm, ou
+ * SONAR_MM_INVALIDO antes da primeira medição */
+uint16_t medicao_filtrada_mm(){
+    return sonar[SENSOR_FRENTE].filtro.mediana;
+}
+
+/* Validade da última medição: 0 se a última medição falhou */
+uint8_t medicao_valida(){
+    return sonar[SENSOR_FRENTE].publicada.status == SONAR_VALIDA;
+}
+
+/* Resultado da última medição: SONAR_VALIDA, SONAR_SEM_ALVO, ... */
+uint8_t medicao_status(){
+    return sonar[SENSOR_FRENTE].publicada.status;
+}
+
+/* Tempo (32 bits) do fim da última medição */
+uint32_t medicao_tempo(){
 
-    /* Variaveis para obter o valor das interrupcoes de borda de subida
-     * e descida para a partir desses dados calcular a distancia */
-    uint16_t timer_count_0 = 0;
-    uint16_t timer_count_1 = 0;
+    struct sonar_amostra_t amostra;
 
+    sonar_le(&sonar[SENSOR_FRENTE], &amostra);
 
+    return amostra.tempo;
+}
+
+/* Ecos que não terminaram dentro de SONAR_TIMEOUT, todos os sensores */
+uint16_t medicao_timeouts(){
+
+    uint16_t timeouts = 0;
+    uint8_t i;
+
+    for (i = 0; i < SONAR_SENSORES; i++)
+        timeouts += sonar[i].timeouts;
+
+    return timeouts;
+}
+
+/* Distância filtrada recente na última medição: 0 se medições perdidas
+ * seguidas (ou nenhuma medição) deixaram medicao_filtrada_mm() velha */
+uint8_t medicao_recente(){
+    return sonar[SENSOR_FRENTE].publicada.mm != SONAR_MM_INVALIDO;
+}
+
+/**
+ * @brief  Entrega a medição mais recente de um sensor se ela ainda não
+ *         foi lida. O main chama ao acordar: a ISR de captura (ou o
+ *         timeout) acorda o main a cada medição terminada.
+ *
+ * @param  sensor: 0 a SONAR_SENSORES - 1.
+ *         amostra: destino da medição: largura, tempo, distância
+ *         filtrada (SONAR_MM_INVALIDO se velha) e status.
+ *
+ * @retval 1 se há uma medição nova em amostra, 0 se nada mudou.
+ */
+uint8_t medicao_nova(uint8_t sensor, struct sonar_amostra_t *amostra){
+
+    if (sonar[sensor].geracao == geracao_lida[sensor])
+        return 0;
+
+    geracao_lida[sensor] = sonar_le(&sonar[sensor], amostra);
+
+    return 1;
+}
+
+/**
+ * @brief  Tabela das distâncias filtradas de todos os sensores.
+ *
+ * @param  mm: destino com SONAR_SENSORES posições, em mm
+ *         (SONAR_MM_INVALIDO se velha).
+ *
+ * @retval none
+ */
+void medicao_tabela(uint16_t *mm){
+
+    uint8_t i;
+
+    /* 16 bits: cada distância é lida de uma vez só */
+    for (i = 0; i < SONAR_SENSORES; i++)
+        mm[i] = sonar[i].publicada.mm;
+}
+
+
+/* Comparador 0 do sensor ativo: agendamento das medições. A decisão é
+ * de sonar_comparador(); aqui só os registradores.
+ *
+ *  SONAR_FASE_PULSO: fim do pulso de trigger. A saída já desceu pelo
+ *  hardware: aqui ela é desligada para o pulso não se repetir na volta
+ *  do timer.
+ *
+ *  SONAR_CCR0_TIMEOUT: o eco não terminou em SONAR_TIMEOUT após o fim
+ *  do pulso. A medição é encerrada, o main é acordado e o próximo
+ *  sensor agendado no ritmo rápido (sonar_timeout).
+ *
+ *  SONAR_CCR0_PULSO: pulso no tempo exato (CCR1 = próximo), fim em
+ *  CCR0.
+ *
+ * base é constante em cada ISR: com a função inline o compilador
+ * resolve os endereços dos registradores.
+ *
+ * Retorna 1 se o main deve ser acordado. */
+static inline uint8_t isr_comparador(uint8_t sensor, const uint16_t base){
+
+    uint32_t agora;
+    uint16_t ccr0;
+    uint8_t acorda;
+
+    if (agendamento.fase == SONAR_FASE_PULSO)
+        TIMER_REG(base, OFS_TBxCCTL1) = OUTMOD_0;
+
+    agora = tempo_captura(sensor, base, TIMER_REG(base, OFS_TBxR));
+
+    switch (sonar_comparador(&agendamento, agora, &ccr0)){
+
+    case SONAR_CCR0_PULSO:
+        TIMER_REG(base, OFS_TBxCCR1) = (uint16_t)agendamento.proximo;
+        TIMER_REG(base, OFS_TBxCCR0) = ccr0;
+        /* Dispara: uma escrita só */
+        TIMER_REG(base, OFS_TBxCCTL1) = OUTMOD_3;
+        sonar_dispara(&sonar[sensor], agendamento.proximo);
+        break;
+
+    case SONAR_CCR0_TIMEOUT:
+        acorda = sonar_timeout(&sonar[sensor], agora);
+        proxima_medicao(sensor, agora);
+        return acorda;
+
+    default:
+        TIMER_REG(base, OFS_TBxCCR0) = ccr0;
+        break;
+    }
+
+    return 0;
+}
+
+/* Captura do eco e voltas do timer de um sensor.
+ * Retorna 1 se o main deve ser acordado. */
+static inline uint8_t isr_captura(uint8_t sensor, const uint16_t base){
+
+    uint16_t ccr, cctl;
+    uint32_t tempo;
+    uint8_t acorda = 0;
 
     /*usar para gerar mais de uma atividade na interrupÃ§Ã£o
      * ver exemplo 05_main_simple_timer0_b.c*/
-    switch(__even_in_range(TB1IV,TBxIV_TBIFG)){
+    switch(__even_in_range(TIMER_REG(base, OFS_TBxIV), TBxIV_TBIFG)){
 
     /* Vector  0:  No interrupt */
     case  TBxIV_NONE:
@@ -155,37 +459,102 @@ void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
         break;
         /* Vector  4:  TACCR2 CCIFG -> ComparaÃ§Ã£o 2*/
     case TBxIV_TBCCR2:
-
-        TB1CCTL2 &= ~CCIFG;
+        /* A leitura de TBxIV já limpou CCIFG: limpar de novo aqui poderia
+         * apagar a captura da borda seguinte */
+        ccr = TIMER_REG(base, OFS_TBxCCR2);
+        /* Lido depois de TBxCCR2: CCIFG indica que a borda seguinte já
+         * foi capturada. COV é limpo por software. */
+        cctl = TIMER_REG(base, OFS_TBxCCTL2);
+        TIMER_REG(base, OFS_TBxCCTL2) &= ~COV;
 
         PORT_OUT(LED2_PORT) ^= LED_2;
 
-        if (TST_BIT(P2IN, BIT1)){
-            timer_count_0 = TB1CCR2;
-        }
-        /* Borda de descida */
-        else {
-            timer_count_1 = TB1CCR2;
-            distancia = timer_count_1 - timer_count_0;  //calculo da distancia
-
-            /* Acorda main
-                __bic_SR_register_on_exit(LPM0_bits); */
+        /* Bordas tratadas em sonar.c: o estado é mantido entre as
+         * interrupções e o tipo da borda vem dos bits de captura.
+         * Fim da medição: agenda o próximo sensor e acorda o main */
+        tempo = tempo_captura(sensor, base, ccr);
+        if (sonar_captura(&sonar[sensor], cctl, tempo)){
+            proxima_medicao(sensor, tempo);
+            acorda = 1;
         }
         break;
 
         /* Vector 10:  TAIFG -> Overflow do timer */
     case TBxIV_TBIFG:
-        //PORT_OUT(LED2_PORT) ^= LED_2;
+        voltas[sensor]++;
         break;
     default:
         break;
     }
 
+    return acorda;
+}
+
+
+/* Timer1 Interrupt Handler
+ * Interrupcao para obter o valor do comparador na
+ * borda de subbida e na borda de descida*/
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER1_B1_VECTOR
+__interrupt void TIMER1_B1_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER1_B1_VECTOR))) TIMER1_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if (isr_captura(0, TIMER_B1_BASE))
+        __bic_SR_register_on_exit(LPM0_bits);
+}
+
+
+/* ISR0 do Timer B1: agendamento do sensor 0 (comparação com TB1CCR0) */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER1_B0_VECTOR
+__interrupt void TIMER1_B0_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER1_B0_VECTOR))) TIMER1_B0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if (isr_comparador(0, TIMER_B1_BASE))
+        __bic_SR_register_on_exit(LPM0_bits);
+}
+
+#if SONAR_SENSORES > 1
+/* Timer2: captura do eco e voltas do sensor 1 */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER2_B1_VECTOR
+__interrupt void TIMER2_B1_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER2_B1_VECTOR))) TIMER2_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if (isr_captura(1, TIMER_B2_BASE))
+        __bic_SR_register_on_exit(LPM0_bits);
 }
 
+/* ISR0 do Timer B2: agendamento do sensor 1 */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER2_B0_VECTOR
+__interrupt void TIMER2_B0_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER2_B0_VECTOR))) TIMER2_B0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if (isr_comparador(1, TIMER_B2_BASE))
+        __bic_SR_register_on_exit(LPM0_bits);
+}
+#endif
+
 
 /* ISR do watchdog: executado toda a vez que o temporizador estoura.
- * Usado para acordar o main periodicamente para poder dar o pulso do trigger. */
+ * Base de tempo do main (telemetria): o sensor tem seu próprio ritmo. */
 #if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
 #pragma vector=WDT_VECTOR
 __interrupt void watchdog_timer(void)
@@ -195,6 +564,8 @@ void __attribute__ ((interrupt(WDT_VECTOR))) watchdog_timer (void)
 #error Compiler not supported!
 #endif
 {
+    wdt_ticks++;
+
     /*Acorda o main*/
     __bic_SR_register_on_exit(LPM0_bits);
 }
@@ -14,6 +14,21 @@
 #include <msp430.h>
 #include <stdint.h>
 #include <bits.h>
+#include "sonar.h"
+
+/* Quantidade de sensores HC-SR04: 1 (Timer B1) ou 2 (Timers B1 e B2) */
+#define SONAR_SENSORES (1)
+
+/* 1: sensor da frente em um servo (Timer B2), mapa polar das distâncias
+ * (varredura.c). Usa o timer do segundo sensor */
+#define SONAR_VARREDURA (0)
+
+/* Sensor usado na detecção de obstáculos e nas funções medicao_*()
+ * sem índice */
+#define SENSOR_FRENTE (0)
+
+/* Estouros do watchdog configurado por config_wd_as_timer() */
+extern volatile uint16_t wdt_ticks;
 
 void init_clock_system(void);
 void config_timerB_1();
@@ -21,5 +36,14 @@ void config_wd_as_timer();
 void trigger();
 void init_sensor();
 uint32_t medicao_distancia();
+uint16_t medicao_distancia_mm();
+uint16_t medicao_filtrada_mm();
+uint8_t medicao_valida();
+uint8_t medicao_status();
+uint32_t medicao_tempo();
+uint16_t medicao_timeouts();
+uint8_t medicao_recente();
+uint8_t medicao_nova(uint8_t sensor, struct sonar_amostra_t *amostra);
+void medicao_tabela(uint16_t *mm);
 
 #endif /* DISTANCIA_H_ */
@@ -0,0 +1,149 @@
+/*
+ *  Modulo: protocolo_host.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Codificador/decodificador do protocolo do carrinho para
+ *  o host (Linux). Usa o mesmo protocolo.c/protocolo.h do MSP430.
+ *
+ *  Compilação (a partir de "Projeto Carrinho"):
+ *      gcc -Wall -I. host/protocolo_host.c protocolo.c -o protocolo_host
+ *
+ *  Uso:
+ *      protocolo_host enc <id> <seq> [bytes...]   -> quadro binário na stdout
+ *      protocolo_host dec                         -> mensagens da stdin em texto
+ *
+ *  Exemplo: motor para frente com velocidade 4200 (0x1068):
+ *      ./protocolo_host enc 1 0 1 0x68 0x10 > /dev/ttyUSB0
+ *      ./protocolo_host enc 1 0 1 0x68 0x10 | ./protocolo_host dec
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "ring_buffer.h"
+#include "protocolo.h"
+
+static uint8_t tx_buffer[64];
+static uint8_t rx_buffer[256];
+
+static int encode(int argc, char **argv){
+
+    struct ring_t tx = RING_INIT(tx_buffer);
+    uint8_t payload[PROTO_MAX_PAYLOAD];
+    uint8_t encoded[sizeof(tx_buffer)];
+    uint16_t n;
+    int i;
+
+    if (argc < 2 || argc - 2 > PROTO_MAX_PAYLOAD){
+        fprintf(stderr, "enc: <id> <seq> [ate %d bytes]\n", PROTO_MAX_PAYLOAD);
+        return 1;
+    }
+
+    for (i = 2; i < argc; i++)
+        payload[i - 2] = strtoul(argv[i], NULL, 0);
+
+    if (!proto_encode(&tx, strtoul(argv[0], NULL, 0), strtoul(argv[1], NULL, 0),
+                      payload, argc - 2))
+        return 1;
+
+    n = ring_read(&tx, encoded, sizeof(encoded));
+    fwrite(encoded, 1, n, stdout);
+
+    return 0;
+}
+
+static int decode(void){
+
+    struct ring_t rx = RING_INIT(rx_buffer);
+    struct proto_decoder_t dec;
+    struct proto_msg_t msg;
+    uint8_t chunk[128];
+    size_t n;
+    int i;
+
+    proto_decoder_init(&dec);
+    /* Na stdin o primeiro quadro começa no primeiro byte */
+    dec.discard = 0;
+
+    while ((n = fread(chunk, 1, ring_free(&rx) < sizeof(chunk) ?
+                      ring_free(&rx) : sizeof(chunk), stdin)) > 0){
+
+        ring_write(&rx, chunk, n);
+
+        while (proto_decode(&dec, &rx, &msg)){
+            printf("id=0x%02x seq=%u", msg.id, msg.seq);
+
+            switch (msg.id){
+            case PROTO_ID_MOTOR:
+                if (msg.size == 3)
+                    printf(" motor direcao=%u velocidade=%u",
+                           msg.payload[0], proto_get_u16(msg.payload + 1));
+                break;
+            case PROTO_ID_ACK:
+                if (msg.size == 2)
+                    printf(" ack seq=%u status=%u", msg.payload[0], msg.payload[1]);
+                break;
+            case PROTO_ID_DISTANCIA:
+                if (msg.size == 4)
+                    printf(" distancia=%u", proto_get_u32(msg.payload));
+                break;
+            case PROTO_ID_ESTAT:
+                if (msg.size == 25)
+                    printf(" uart=%u tx=%u rx=%u quadros=%u overrun=%u framing=%u"
+                           " paridade=%u bytes_descartados=%u quadros_descartados=%u"
+                           " pico_tx=%u pico_rx=%u",
+                           msg.payload[0], proto_get_u32(msg.payload + 1),
+                           proto_get_u32(msg.payload + 5), proto_get_u16(msg.payload + 9),
+                           proto_get_u16(msg.payload + 11), proto_get_u16(msg.payload + 13),
+                           proto_get_u16(msg.payload + 15), proto_get_u16(msg.payload + 17),
+                           proto_get_u16(msg.payload + 19), proto_get_u16(msg.payload + 21),
+                           proto_get_u16(msg.payload + 23));
+                break;
+            case PROTO_ID_ALARME:
+                if (msg.size == 3)
+                    printf(" alarme tipo=%u valor=%u", msg.payload[0],
+                           proto_get_u16(msg.payload + 1));
+                break;
+            case PROTO_ID_TELEMETRIA:
+                if (msg.size == 11)
+                    printf(" tempo=%u distancia=%u bateria1=%u bateria2=%u"
+                           " direcao=%u velocidade=%u", proto_get_u16(msg.payload),
+                           proto_get_u16(msg.payload + 2), proto_get_u16(msg.payload + 4),
+                           proto_get_u16(msg.payload + 6), msg.payload[8],
+                           proto_get_u16(msg.payload + 9));
+                break;
+            case PROTO_ID_BATERIA:
+                if (msg.size == 4)
+                    printf(" bateria1=%u bateria2=%u", proto_get_u16(msg.payload),
+                           proto_get_u16(msg.payload + 2));
+                break;
+            default:
+                printf(" dados=");
+                for (i = 0; i < msg.size; i++)
+                    printf("%02x", msg.payload[i]);
+                break;
+            }
+            printf("\n");
+        }
+    }
+
+    fprintf(stderr, "erros: crc=%u quadro=%u perdidas=%u duplicadas=%u\n",
+            dec.crc_errors, dec.framing_errors, dec.lost, dec.duplicates);
+
+    return 0;
+}
+
+int main(int argc, char **argv){
+
+    if (argc >= 2 && strcmp(argv[1], "enc") == 0)
+        return encode(argc - 2, argv + 2);
+
+    if (argc >= 2 && strcmp(argv[1], "dec") == 0)
+        return decode();
+
+    fprintf(stderr, "uso: %s enc <id> <seq> [bytes...] | dec\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,584 @@
+/*
+ *  Modulo: sonar_sim.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Simulador do HC-SR04 para o host (Linux). Executa o código
+ *  de captura do carrinho (sonar.c) com um modelo do Timer B1, sem o
+ *  hardware, para medir a precisão e o custo do caminho de captura.
+ *
+ *  - Timer B1 modelado como em hc_sr04.c: contagem contínua de 16 bits
+ *    com TBIFG e contador de voltas, captura nas duas bordas em TB1CCR2
+ *    com CCIFG, COV e CCI, e a prioridade da captura sobre TBIFG no
+ *    TB1IV.
+ *  - As ISRs são atendidas com latência aleatória: bordas próximas
+ *    chegam com CCIFG de novo ou sobrescrevem a captura (COV), como no
+ *    hardware.
+ *  - Extensão para 32 bits (sonar_tempo) e agendamento no comparador 0
+ *    (sonar_agenda, sonar_comparador) com o mesmo código de hc_sr04.c:
+ *    a ISR0 é atendida na comparação com TB1CCR0 e o pulso de trigger
+ *    sai na comparação com TB1CCR1.
+ *  - Alvo que se aproxima e se afasta entre SIM_MIN_MM e SIM_MAX_MM;
+ *    além de SIM_ALCANCE_MM o sensor dá o eco de 38ms (sem alvo).
+ *  - Falhas: sensor sem resposta, eco preso em nível alto (descida
+ *    perdida) e pulsos espúrios no pino do eco.
+ *  - Bordas do eco forçadas no instante da volta do timer (-w): a
+ *    captura com TB1CCR2 = 0 e TBIFG no mesmo instante.
+ *  - Resultado: contagem dos resultados, erro da distância medida e da
+ *    filtrada, erro da velocidade de aproximação (sonar_aprox_insere) e
+ *    ciclos do host por medição no código de captura.
+ *
+ *  Compilação (a partir de "Projeto Carrinho"):
+ *      gcc -O2 -Wall -I. host/sonar_sim.c sonar.c -o sonar_sim -lm
+ *
+ *  Uso:
+ *      sonar_sim [-n medições] [-d mm] [-v mm/s] [-r ruído] [-l latência]
+ *                [-p %] [-f %] [-g %] [-w %] [-T décimos] [-c] [-s semente]
+ *                [-e erro] [-m erro] [-E erro] [-o arquivo.csv]
+ *
+ *  Exemplos:
+ *      ./sonar_sim -n 100000 -v 500 -l 50 -g 1
+ *      ./sonar_sim -e 5 -m 20 -E 40 && echo ok
+ *      ./sonar_sim -n 50000 -w 20 -e 5 -m 20 && echo ok
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "sonar.h"
+
+/* Sem evento pendente */
+#define NUNCA UINT64_MAX
+
+/* Contagens do timer em um microssegundo */
+#define US(x) ((uint64_t)((x) * (double)SONAR_TIMER_FREQ / 1000000.0))
+
+/* Contagens entre a leitura de TB1IV/TB1CCR2 e a de TB1CCTL2 na ISR */
+#define SIM_LEITURA       (3)
+
+/* Sensor: atraso do trigger até o eco, alcance e eco sem alvo */
+#define SIM_ATRASO_ECO_US (460)
+#define SIM_ALCANCE_MM    (4000)
+#define SIM_SEM_ALVO_US   (38000)
+/* Eco preso em nível alto */
+#define SIM_PRESO_US      (200000)
+
+/* Limites do movimento do alvo */
+#define SIM_MIN_MM        (150)
+#define SIM_MAX_MM        (4500)
+
+#define SIM_BORDAS_MAX    (4)
+
+/* Erro acumulado: média, RMS e máximo */
+struct erro_t {
+    unsigned long n;
+    double soma, soma2, max;
+};
+
+/* Parâmetros */
+static unsigned long n_medicoes = 10000;
+static double d_inicial = 1000, velocidade = 300, ruido = 2;
+static double latencia_us = 20, p_sem_resposta = 0, p_preso = 0, p_espurio = 0, p_na_volta = 0;
+static int temperatura = SONAR_TEMPERATURA, compensa;
+static double erro_max = -1, erro_pior = -1, erro_filtrado_max = -1;
+static FILE *csv;
+
+/* Código em teste */
+static struct sonar_t sonar;
+static struct sonar_aprox_t aprox;
+
+/* Tempo simulado em contagens do timer e a próxima volta: avança só
+ * quando a volta é tratada, mesmo com outro evento no mesmo instante */
+static uint64_t agora, t_estouro = 0x10000;
+
+/* Timer B1 simulado */
+static uint16_t ccr0, ccr1, ccr2, cctl2, voltas;
+static uint8_t tbifg, pino;
+
+/* Agendamento do comparador 0 (sonar.c) */
+static struct sonar_agenda_t agendamento;
+
+/* Bordas do eco pendentes, em ordem */
+static uint64_t bordas[SIM_BORDAS_MAX];
+static int n_bordas, proxima_borda;
+
+/* Comparações com TB1CCR0 e TB1CCR1 (início do pulso) e atendimento
+ * das interrupções (NUNCA: nada pendente) */
+static uint64_t t_comparacao = NUNCA, t_pulso = NUNCA;
+static uint64_t t_captura = NUNCA, t_leitura = NUNCA, t_volta = NUNCA, t_isr0 = NUNCA;
+static uint16_t ccr_lido;
+
+/* Verdade da medição em andamento */
+static double real_mm, real_vel;
+
+/* Resultados */
+static unsigned long medicoes, validas, sem_alvo, invalidas, sem_resposta, classe_errada;
+static struct erro_t erro_bruto, erro_filtrado, erro_vel;
+static uint64_t ciclos_captura;
+static double ns_captura;
+
+static double aleatorio(void){
+    return rand() / ((double)RAND_MAX + 1);
+}
+
+static double gaussiano(void){
+    return sqrt(-2 * log(1 - aleatorio())) * cos(2 * M_PI * aleatorio());
+}
+
+static uint64_t latencia(void){
+    return US(latencia_us * aleatorio());
+}
+
+static uint64_t ciclos(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static double ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void acumula(struct erro_t *e, double erro){
+    e->n++;
+    e->soma += erro;
+    e->soma2 += erro * erro;
+    if (fabs(erro) > e->max)
+        e->max = fabs(erro);
+}
+
+static double rms(const struct erro_t *e){
+    return e->n ? sqrt(e->soma2 / e->n) : 0;
+}
+
+static void mostra(const char *nome, const struct erro_t *e){
+    printf("%-26s n=%lu medio=%.2f rms=%.2f max=%.2f\n", nome, e->n,
+           e->n ? e->soma / e->n : 0, rms(e), e->max);
+}
+
+/* Posição do alvo: vai e volta entre SIM_MIN_MM e SIM_MAX_MM */
+static double distancia_real(uint64_t t){
+
+    double faixa = SIM_MAX_MM - SIM_MIN_MM;
+    double x = fmod(d_inicial - SIM_MIN_MM - velocidade * t / SONAR_TIMER_FREQ, 2 * faixa);
+
+    if (x < 0)
+        x += 2 * faixa;
+
+    return x <= faixa ? SIM_MIN_MM + x : SIM_MIN_MM + 2 * faixa - x;
+}
+
+/* Velocidade do som (mm/us) na temperatura simulada */
+static double som_mm_us(void){
+    return (331.3 + 0.606 * temperatura / 10.0) / 1000.0;
+}
+
+/* Tempo de 32 bits como tempo_captura() de hc_sr04.c */
+static uint32_t tempo_captura(uint16_t ccr){
+    return sonar_tempo(voltas, tbifg, ccr);
+}
+
+static uint32_t tempo_atual(void){
+    return tempo_captura((uint16_t)agora);
+}
+
+/* Próxima vez que TB1R passa por ccr: CCR igual a TB1R só na volta
+ * seguinte */
+static uint64_t comparacao(uint16_t ccr){
+
+    uint16_t falta = ccr - (uint16_t)agora;
+
+    return agora + (falta ? falta : 0x10000);
+}
+
+/* Escrita em TB1CCR0 */
+static void escreve_ccr0(uint16_t valor){
+    ccr0 = valor;
+    t_comparacao = comparacao(ccr0);
+}
+
+/* Próximo disparo, como agenda() de hc_sr04.c: CCR0 logo adiante e
+ * CCIFG limpo (TB1CCTL0 = CCIE) */
+static void agenda(uint32_t quando){
+
+    if (!sonar_agenda(&agendamento, quando))
+        return;
+
+    escreve_ccr0((uint16_t)agora + SONAR_TRIGGER_ATRASO);
+    t_isr0 = NUNCA;
+}
+
+static void insere_borda(uint64_t t){
+
+    int i = n_bordas++;
+
+    while (i > proxima_borda && bordas[i - 1] > t){
+        bordas[i] = bordas[i - 1];
+        i--;
+    }
+    bordas[i] = t;
+}
+
+/* Início do pulso de trigger (comparação com TB1CCR1): gera as bordas
+ * do eco. Sensor ocupado (eco preso) ignora o trigger */
+static void dispara(void){
+
+    uint64_t subida, descida, espurio;
+    double largura_us;
+
+    real_mm = distancia_real(agora);
+    real_vel = (distancia_real(agora) - distancia_real(agora + US(1000))) * 1000;
+    t_pulso = NUNCA;
+
+    if (pino || proxima_borda < n_bordas)
+        return;
+
+    n_bordas = proxima_borda = 0;
+
+    if (aleatorio() * 100 < p_sem_resposta){
+        sem_resposta++;
+        return;
+    }
+
+    if (real_mm > SIM_ALCANCE_MM)
+        largura_us = SIM_SEM_ALVO_US;
+    else
+        largura_us = 2 * (real_mm + ruido * gaussiano()) / som_mm_us();
+
+    subida = agora + SONAR_TRIGGER_LARGURA + US(SIM_ATRASO_ECO_US + 10 * gaussiano());
+    descida = subida + US(largura_us);
+    if (aleatorio() * 100 < p_preso)
+        descida = subida + US(SIM_PRESO_US);
+
+    /* Eco atrasado até uma das bordas cair na volta do timer: a largura
+     * não muda e o eco termina antes do timeout (alvo no alcance) */
+    if (p_na_volta > 0 && real_mm <= SIM_ALCANCE_MM && aleatorio() * 100 < p_na_volta){
+        uint64_t b = aleatorio() < 0.5 ? subida : descida;
+        uint64_t atraso = (((b - 1) | 0xffff) + 1) - b;
+
+        subida += atraso;
+        descida += atraso;
+    }
+
+    insere_borda(subida);
+    insere_borda(descida);
+
+    /* Pulso espúrio de 5 a 30us em qualquer ponto do eco */
+    if (aleatorio() * 100 < p_espurio){
+        espurio = subida - US(2000) + (uint64_t)((descida - subida + US(2000)) * aleatorio());
+        insere_borda(espurio);
+        insere_borda(espurio + US(5 + 25 * aleatorio()));
+    }
+}
+
+/* Fim da medição: compara com a verdade e agenda a próxima */
+static void termina(void){
+
+    struct sonar_amostra_t amostra;
+    uint32_t quando;
+    uint8_t esperado;
+
+    sonar_le(&sonar, &amostra);
+    medicoes++;
+
+    esperado = real_mm > SIM_ALCANCE_MM ? SONAR_SEM_ALVO : SONAR_VALIDA;
+
+    switch (amostra.status){
+    case SONAR_VALIDA:
+        validas++;
+        acumula(&erro_bruto, sonar_mm(amostra.largura) - real_mm);
+        if (amostra.mm != SONAR_MM_INVALIDO)
+            acumula(&erro_filtrado, amostra.mm - real_mm);
+        break;
+    case SONAR_SEM_ALVO:
+        sem_alvo++;
+        break;
+    default:
+        invalidas++;
+        break;
+    }
+    if (amostra.status != SONAR_INVALIDA && amostra.status != esperado)
+        classe_errada++;
+
+    /* Aproximação como no main */
+    if (amostra.bruta != SONAR_MM_INVALIDO){
+        sonar_aprox_insere(&aprox, amostra.tempo, amostra.bruta);
+        if (aprox.quantidade >= SONAR_APROX_MIN)
+            acumula(&erro_vel, aprox.velocidade - real_vel);
+    }
+    else if (amostra.status == SONAR_SEM_ALVO)
+        sonar_aprox_init(&aprox);
+
+    if (csv)
+        fprintf(csv, "%.3f,%.1f,%u,%u,%u,%d,%.0f\n", agora * 1000.0 / SONAR_TIMER_FREQ,
+                real_mm, sonar_mm(amostra.largura), amostra.mm, amostra.status,
+                aprox.velocidade, real_vel);
+
+    sonar_rodizio(&sonar, 1, 0, &quando);
+    agenda(quando);
+}
+
+/* Borda no pino do eco: captura em TB1CCR2 (CM_3) */
+static void borda(void){
+
+    proxima_borda++;
+    pino ^= 1;
+
+    if (cctl2 & SONAR_CCTL_CCIFG)
+        cctl2 |= SONAR_CCTL_COV;
+    ccr2 = (uint16_t)agora;
+    cctl2 |= SONAR_CCTL_CCIFG;
+
+    if (t_captura == NUNCA && t_leitura == NUNCA)
+        t_captura = agora + latencia();
+}
+
+/* ISR de captura, primeira parte: leitura de TB1IV (limpa CCIFG) e de
+ * TB1CCR2 */
+static void isr_captura(void){
+    cctl2 &= ~SONAR_CCTL_CCIFG;
+    ccr_lido = ccr2;
+    t_captura = NUNCA;
+    t_leitura = agora + SIM_LEITURA;
+}
+
+/* ISR de captura, segunda parte: leitura de TB1CCTL2 e sonar_captura */
+static void isr_leitura(void){
+
+    uint16_t cctl = cctl2 | (pino ? SONAR_CCTL_CCI : 0);
+    uint64_t c0;
+    double n0;
+    uint8_t fim;
+
+    cctl2 &= ~SONAR_CCTL_COV;
+    t_leitura = NUNCA;
+
+    n0 = ns();
+    c0 = ciclos();
+    fim = sonar_captura(&sonar, cctl, tempo_captura(ccr_lido));
+    ciclos_captura += ciclos() - c0;
+    ns_captura += ns() - n0;
+
+    if (fim)
+        termina();
+
+    /* Borda capturada durante a ISR: a interrupção volta */
+    if (cctl2 & SONAR_CCTL_CCIFG)
+        t_captura = agora + latencia();
+}
+
+/* ISR0: agendamento e timeout do eco, como isr_comparador() de
+ * hc_sr04.c. O fim do pulso (OUTMOD_0) não muda o pino do eco */
+static void isr0(void){
+
+    uint32_t tempo = tempo_atual();
+    uint16_t valor;
+    uint64_t c0;
+    double n0;
+    uint8_t fim;
+
+    t_isr0 = NUNCA;
+
+    switch (sonar_comparador(&agendamento, tempo, &valor)){
+
+    case SONAR_CCR0_PULSO:
+        ccr1 = (uint16_t)agendamento.proximo;
+        t_pulso = comparacao(ccr1);
+        escreve_ccr0(valor);
+        sonar_dispara(&sonar, agendamento.proximo);
+        break;
+
+    case SONAR_CCR0_TIMEOUT:
+        c0 = ciclos();
+        n0 = ns();
+        fim = sonar_timeout(&sonar, tempo);
+        ciclos_captura += ciclos() - c0;
+        ns_captura += ns() - n0;
+        if (fim)
+            termina();
+        break;
+
+    default:
+        escreve_ccr0(valor);
+        break;
+    }
+}
+
+static void simula(void){
+
+    uint64_t t_borda, proximo;
+
+    while (medicoes < n_medicoes){
+        t_borda = proxima_borda < n_bordas ? bordas[proxima_borda] : NUNCA;
+
+        /* ISR de captura em andamento: as outras esperam o fim dela */
+        if (t_leitura != NUNCA){
+            if (t_isr0 < t_leitura) t_isr0 = t_leitura;
+            if (t_volta < t_leitura) t_volta = t_leitura;
+        }
+
+        proximo = t_borda;
+        if (t_estouro < proximo) proximo = t_estouro;
+        if (t_comparacao < proximo) proximo = t_comparacao;
+        if (t_pulso < proximo) proximo = t_pulso;
+        if (t_leitura < proximo) proximo = t_leitura;
+        if (t_isr0 < proximo) proximo = t_isr0;
+        if (t_captura < proximo) proximo = t_captura;
+        if (t_volta < proximo) proximo = t_volta;
+        agora = proximo;
+
+        /* Hardware primeiro, depois as ISRs em ordem de prioridade */
+        if (agora == t_borda)
+            borda();
+        else if (agora == t_estouro){
+            t_estouro += 0x10000;
+            tbifg = 1;
+            if (t_volta == NUNCA)
+                t_volta = agora + latencia();
+        }
+        else if (agora == t_comparacao){
+            /* CCIFG de TB1CCR0: a próxima comparação é na volta seguinte */
+            t_comparacao = comparacao(ccr0);
+            if (t_isr0 == NUNCA)
+                t_isr0 = agora + latencia();
+        }
+        else if (agora == t_pulso)
+            dispara();
+        else if (agora == t_leitura)
+            isr_leitura();
+        else if (agora == t_isr0)
+            isr0();
+        else if (agora == t_captura)
+            isr_captura();
+        else if (agora == t_volta){
+            /* TB1IV: captura pendente é atendida antes de TBIFG */
+            if (cctl2 & SONAR_CCTL_CCIFG)
+                isr_captura();
+            else {
+                voltas++;
+                tbifg = 0;
+                t_volta = NUNCA;
+            }
+        }
+    }
+}
+
+static void uso(const char *nome){
+    fprintf(stderr, "uso: %s [opcoes]\n"
+            "  -n  medicoes (padrao 10000)\n"
+            "  -d  distancia inicial do alvo em mm (padrao 1000)\n"
+            "  -v  velocidade do alvo em mm/s (padrao 300)\n"
+            "  -r  ruido da distancia em mm, desvio padrao (padrao 2)\n"
+            "  -l  latencia maxima das ISRs em us (padrao 20)\n"
+            "  -p  %% de triggers sem resposta do sensor\n"
+            "  -f  %% de ecos presos em nivel alto (descida perdida)\n"
+            "  -g  %% de ecos com pulso espurio\n"
+            "  -w  %% de ecos com uma borda no instante da volta do timer\n"
+            "  -T  temperatura do ar em decimos de grau (padrao %d)\n"
+            "  -c  compensa a temperatura no firmware (sonar_temperatura)\n"
+            "  -s  semente\n"
+            "  -e  erro RMS maximo da distancia medida (mm): falha acima disso\n"
+            "  -m  erro maximo de uma medida valida (mm): falha acima disso\n"
+            "  -E  erro RMS maximo da distancia filtrada (mm): falha acima disso\n"
+            "  -o  grava as medicoes em CSV\n", nome, SONAR_TEMPERATURA);
+}
+
+int main(int argc, char **argv){
+
+    unsigned int semente = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:v:r:l:p:f:g:w:T:cs:e:m:E:o:")) != -1){
+        switch (opt){
+        case 'n': n_medicoes = strtoul(optarg, NULL, 0); break;
+        case 'd': d_inicial = strtod(optarg, NULL); break;
+        case 'v': velocidade = strtod(optarg, NULL); break;
+        case 'r': ruido = strtod(optarg, NULL); break;
+        case 'l': latencia_us = strtod(optarg, NULL); break;
+        case 'p': p_sem_resposta = strtod(optarg, NULL); break;
+        case 'f': p_preso = strtod(optarg, NULL); break;
+        case 'g': p_espurio = strtod(optarg, NULL); break;
+        case 'w': p_na_volta = strtod(optarg, NULL); break;
+        case 'T': temperatura = strtol(optarg, NULL, 0); break;
+        case 'c': compensa = 1; break;
+        case 's': semente = strtoul(optarg, NULL, 0); break;
+        case 'e': erro_max = strtod(optarg, NULL); break;
+        case 'm': erro_pior = strtod(optarg, NULL); break;
+        case 'E': erro_filtrado_max = strtod(optarg, NULL); break;
+        case 'o':
+            if (!(csv = fopen(optarg, "w"))){
+                perror(optarg);
+                return 1;
+            }
+            fputs("t_ms,real,medida,filtrada,status,velocidade,velocidade_real\n", csv);
+            break;
+        default:
+            uso(argv[0]);
+            return 1;
+        }
+    }
+
+    srand(semente);
+    sonar_init(&sonar);
+    /* Primeira medição o quanto antes, como trigger() */
+    agenda(0);
+    sonar_aprox_init(&aprox);
+    if (compensa)
+        sonar_temperatura(temperatura);
+
+    simula();
+
+    printf("medicoes=%lu validas=%lu sem_alvo=%lu invalidas=%lu\n",
+           medicoes, validas, sem_alvo, invalidas);
+    printf("erros=%u timeouts=%u outliers=%u sem_resposta=%lu classe_errada=%lu\n",
+           sonar.erros, sonar.timeouts, sonar.filtro.outliers, sem_resposta, classe_errada);
+    printf("tempo simulado=%.1fs taxa=%.1f medicoes/s\n", (double)agora / SONAR_TIMER_FREQ,
+           medicoes * (double)SONAR_TIMER_FREQ / agora);
+    mostra("erro medida (mm)", &erro_bruto);
+    mostra("erro filtrada (mm)", &erro_filtrado);
+    mostra("erro velocidade (mm/s)", &erro_vel);
+    printf("captura por medicao (host): %.0f ciclos, %.0f ns\n",
+           (double)ciclos_captura / medicoes, ns_captura / medicoes);
+
+    if (csv)
+        fclose(csv);
+
+    if (erro_max >= 0 && rms(&erro_bruto) > erro_max){
+        fprintf(stderr, "erro rms %.2f mm acima de %.2f mm\n", rms(&erro_bruto), erro_max);
+        return 2;
+    }
+
+    /* Uma medida válida muito errada pára o carrinho por um obstáculo
+     * que não existe: quase não muda o RMS */
+    if (erro_pior >= 0 && erro_bruto.max > erro_pior){
+        fprintf(stderr, "erro de uma medida %.2f mm acima de %.2f mm\n", erro_bruto.max, erro_pior);
+        return 2;
+    }
+
+    /* Filtro lento ou preso (mediana, rejeição de saltos) não aparece no
+     * erro da medida */
+    if (erro_filtrado_max >= 0 && rms(&erro_filtrado) > erro_filtrado_max){
+        fprintf(stderr, "erro rms filtrada %.2f mm acima de %.2f mm\n",
+                rms(&erro_filtrado), erro_filtrado_max);
+        return 2;
+    }
+
+    return 0;
+}
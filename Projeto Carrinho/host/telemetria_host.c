@@ -0,0 +1,356 @@
+/*
+ *  Modulo: telemetria_host.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Gravador e decodificador da telemetria do carrinho para
+ *  o host (Linux). Lê o fluxo da serial (tty) ou de um arquivo,
+ *  decodifica os quadros com protocolo.c e grava CSV ou um log binário.
+ *
+ *  - Sem alocação por registro: a entrada é lida direto para um único
+ *    buffer circular preparado no início e a saída usa um buffer fixo.
+ *  - Log binário: cabeçalho TELEM_LOG_MAGIC seguido de registros
+ *
+ *      +-------------+----+-----+------+-----------------+
+ *      | dt (us) u32 | id | seq | size | dados (size)    |
+ *      +-------------+----+-----+------+-----------------+
+ *
+ *    dt é o tempo desde o registro anterior (little-endian).
+ *  - Um log binário na entrada é reproduzido: sem -x o mais rápido
+ *    possível, com -x N os intervalos são divididos por N.
+ *
+ *  Compilação (a partir de "Projeto Carrinho"):
+ *      gcc -O2 -Wall -I. host/telemetria_host.c protocolo.c -o telemetria_host
+ *
+ *  Uso:
+ *      telemetria_host [-b] [-s baudrate] [-x fator] <entrada> [saída]
+ *
+ *      entrada: /dev/ttyUSB0, captura bruta, log binário ou - (stdin)
+ *      saída: arquivo ou stdout. CSV, ou log binário com -b.
+ *
+ *  Exemplos:
+ *      ./telemetria_host -b /dev/ttyUSB0 corrida.log
+ *      ./telemetria_host -x 100 corrida.log corrida.csv
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+
+#include "ring_buffer.h"
+#include "protocolo.h"
+
+#define TELEM_LOG_MAGIC "CARLOG1\n"
+#define TELEM_LOG_MAGIC_SIZE (sizeof(TELEM_LOG_MAGIC) - 1)
+
+/* Cabeçalho de cada registro do log binário */
+#define TELEM_REG_SIZE (7)
+
+/* Buffer de entrada: potência de 2, no máximo 32768 (índices de 16 bits) */
+static uint8_t rx_buffer[32768];
+/* Buffer da saída (stdio) */
+static char out_buffer[1 << 16];
+
+static FILE *saida;
+static int binario;
+
+/* Tempo do registro anterior, em us */
+static uint64_t t_anterior;
+
+/* Contadores */
+static unsigned long mensagens, ignoradas;
+
+static uint64_t agora_us(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static speed_t baudrate(long baud){
+
+    switch (baud){
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return 0;
+    }
+}
+
+/* Serial em modo raw: bytes chegam sem tratamento do terminal */
+static int configura_tty(int fd, long baud){
+
+    struct termios tio;
+    speed_t speed = baudrate(baud);
+
+    if (!speed){
+        fprintf(stderr, "baudrate nao suportado: %ld\n", baud);
+        return -1;
+    }
+
+    if (tcgetattr(fd, &tio) < 0)
+        return -1;
+
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+static void csv_cabecalho(void){
+    fputs("t,id,seq,tempo,distancia,bateria1,bateria2,direcao,velocidade,"
+          "alarme,valor\n", saida);
+}
+
+/* Uma linha por mensagem: campos que a mensagem não tem ficam vazios */
+static void csv_mensagem(uint64_t t, uint8_t id, uint8_t seq,
+                         const uint8_t *p, uint8_t size){
+
+    fprintf(saida, "%llu.%06llu,%u,%u,", (unsigned long long)(t / 1000000),
+            (unsigned long long)(t % 1000000), id, seq);
+
+    switch (id){
+    case PROTO_ID_TELEMETRIA:
+        if (size != 11)
+            break;
+        fprintf(saida, "%u,%u,%u,%u,%u,%u,,\n", proto_get_u16(p), proto_get_u16(p + 2),
+                proto_get_u16(p + 4), proto_get_u16(p + 6), p[8], proto_get_u16(p + 9));
+        return;
+    case PROTO_ID_DISTANCIA:
+        if (size != 4)
+            break;
+        fprintf(saida, ",%u,,,,,,\n", proto_get_u32(p));
+        return;
+    case PROTO_ID_BATERIA:
+        if (size != 4)
+            break;
+        fprintf(saida, ",,%u,%u,,,,\n", proto_get_u16(p), proto_get_u16(p + 2));
+        return;
+    case PROTO_ID_ALARME:
+        if (size != 3)
+            break;
+        fprintf(saida, ",,,,,,%u,%u\n", p[0], proto_get_u16(p + 1));
+        return;
+    default:
+        break;
+    }
+
+    fputs(",,,,,,,\n", saida);
+}
+
+static void log_mensagem(uint64_t t, uint8_t id, uint8_t seq,
+                         const uint8_t *p, uint8_t size){
+
+    uint8_t reg[TELEM_REG_SIZE];
+    uint64_t dt = t - t_anterior;
+
+    if (dt > 0xffffffff)
+        dt = 0xffffffff;
+
+    proto_set_u32(reg, dt);
+    reg[4] = id;
+    reg[5] = seq;
+    reg[6] = size;
+
+    fwrite(reg, 1, sizeof(reg), saida);
+    fwrite(p, 1, size, saida);
+}
+
+/* Grava uma mensagem no formato escolhido. t: tempo em us */
+static void grava(uint64_t t, uint8_t id, uint8_t seq, const uint8_t *p, uint8_t size){
+
+    /* Respostas de comandos não são telemetria */
+    if (id == PROTO_ID_ACK || id == PROTO_ID_ESTAT){
+        ignoradas++;
+        return;
+    }
+
+    if (binario)
+        log_mensagem(t, id, seq, p, size);
+    else
+        csv_mensagem(t, id, seq, p, size);
+
+    t_anterior = t;
+    mensagens++;
+}
+
+/* Fluxo da serial ou captura bruta: decodifica os quadros COBS */
+static int le_fluxo(int fd, int tty, const uint8_t *inicio, size_t n_inicio){
+
+    struct ring_t rx = RING_INIT(rx_buffer);
+    struct proto_decoder_t dec;
+    struct proto_msg_t msg;
+    uint64_t t0 = agora_us(), t;
+    ssize_t n;
+
+    proto_decoder_init(&dec);
+    /* Em arquivos o primeiro quadro começa no primeiro byte. Na serial
+     * descarta até o primeiro delimitador */
+    dec.discard = tty;
+
+    /* Bytes já lidos na verificação do cabeçalho */
+    ring_write(&rx, inicio, n_inicio);
+
+    do {
+        t = agora_us() - t0;
+
+        while (proto_decode(&dec, &rx, &msg))
+            grava(t, msg.id, msg.seq, msg.payload, msg.size);
+
+        /* O decodificador esvazia o buffer: lê direto para ele,
+         * sem buffer intermediário */
+        rx.head = rx.tail = 0;
+        n = read(fd, rx_buffer, sizeof(rx_buffer));
+        if (n > 0)
+            rx.head = n;
+    } while (n > 0 || (n < 0 && errno == EINTR));
+
+    fprintf(stderr, "mensagens=%lu ignoradas=%lu erros: crc=%u quadro=%u perdidas=%u duplicadas=%u\n",
+            mensagens, ignoradas, dec.crc_errors, dec.framing_errors, dec.lost, dec.duplicates);
+
+    return n < 0;
+}
+
+/* Reprodução de um log binário. fator: 0 o mais rápido possível.
+ * Os registros são lidos em blocos para rx_buffer e tratados no lugar */
+static int reproduz_log(int fd, double fator){
+
+    uint64_t t = 0, t0 = agora_us(), espera, agora;
+    size_t pos = 0, fim = 0, size;
+    ssize_t n = 1;
+
+    while (1){
+        /* Registro incompleto no buffer: move o resto para o início e lê mais */
+        if (fim - pos < TELEM_REG_SIZE ||
+                fim - pos < TELEM_REG_SIZE + (size_t)rx_buffer[pos + 6]){
+            if (n <= 0)
+                break;
+            memmove(rx_buffer, rx_buffer + pos, fim - pos);
+            fim -= pos;
+            pos = 0;
+            n = read(fd, rx_buffer + fim, sizeof(rx_buffer) - fim);
+            if (n < 0 && errno == EINTR)
+                n = 1;
+            else if (n > 0)
+                fim += n;
+            continue;
+        }
+
+        t += proto_get_u32(rx_buffer + pos);
+        size = rx_buffer[pos + 6];
+
+        /* Mantém o ritmo original dividido pelo fator, sem acumular erro */
+        if (fator > 0){
+            espera = t0 + (uint64_t)(t / fator);
+            fflush(saida);
+            while ((agora = agora_us()) < espera)
+                usleep(espera - agora);
+        }
+
+        grava(t, rx_buffer[pos + 4], rx_buffer[pos + 5],
+              rx_buffer + pos + TELEM_REG_SIZE, size);
+        pos += TELEM_REG_SIZE + size;
+    }
+
+    fprintf(stderr, "mensagens=%lu ignoradas=%lu\n", mensagens, ignoradas);
+
+    return n < 0;
+}
+
+static void uso(const char *nome){
+    fprintf(stderr, "uso: %s [-b] [-s baudrate] [-x fator] <entrada> [saida]\n"
+            "  -b  saida em log binario ao inves de CSV\n"
+            "  -s  baudrate da serial (padrao 115200)\n"
+            "  -x  reproducao de log: fator de velocidade (padrao: sem espera)\n",
+            nome);
+}
+
+int main(int argc, char **argv){
+
+    uint8_t magic[TELEM_LOG_MAGIC_SIZE];
+    long baud = 115200;
+    double fator = 0;
+    size_t n = 0;
+    ssize_t r;
+    int fd, opt, ret;
+
+    while ((opt = getopt(argc, argv, "bs:x:")) != -1){
+        switch (opt){
+        case 'b':
+            binario = 1;
+            break;
+        case 's':
+            baud = strtol(optarg, NULL, 0);
+            break;
+        case 'x':
+            fator = strtod(optarg, NULL);
+            break;
+        default:
+            uso(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc){
+        uso(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[optind], "-") == 0)
+        fd = STDIN_FILENO;
+    else if ((fd = open(argv[optind], O_RDONLY | O_NOCTTY)) < 0){
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if (isatty(fd) && configura_tty(fd, baud) < 0){
+        perror("tty");
+        return 1;
+    }
+
+    saida = stdout;
+    if (optind + 1 < argc && !(saida = fopen(argv[optind + 1], "wb"))){
+        perror(argv[optind + 1]);
+        return 1;
+    }
+    setvbuf(saida, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    if (binario)
+        fwrite(TELEM_LOG_MAGIC, 1, TELEM_LOG_MAGIC_SIZE, saida);
+    else
+        csv_cabecalho();
+
+    /* Arquivos e pipes: verifica se é um log binário. Na serial os
+     * primeiros bytes são do fluxo e vão para o decodificador */
+    if (!isatty(fd)){
+        while (n < sizeof(magic) && (r = read(fd, magic + n, sizeof(magic) - n)) > 0)
+            n += r;
+    }
+
+    if (n == sizeof(magic) && memcmp(magic, TELEM_LOG_MAGIC, sizeof(magic)) == 0)
+        ret = reproduz_log(fd, fator);
+    else
+        ret = le_fluxo(fd, isatty(fd), magic, n);
+
+    fclose(saida);
+
+    return ret;
+}
@@ -8,8 +8,14 @@
  *
  *      - Exemplo de recepção e transmissão da USART
  *      - CPU é desligado até o recebimento dos dados.
- *      - Uma mensagem de ACK é enviado quando um pacote
- *      é recebido.
+ *      - Comandos e respostas usam o protocolo binário de protocolo.h.
+ *      Uma mensagem de ACK é enviada quando um comando é recebido.
+ *      - Obstáculo à frente com o carrinho andando para frente: para os
+ *      motores e envia um alarme na fila de alta prioridade da UART.
+ *      Com SONAR_VARREDURA (hc_sr04.h) a frente é o setor central do
+ *      mapa polar do servo.
+ *      - Telemetria periódica (telemetria.c): distância, baterias e estado
+ *      dos motores em uma mensagem só. Período alterado pelo host.
  *
  *      - Clock da CPU é 24MHZ definido e uart_fr2355.h  devido a
  *      configuração do baudrate.
@@ -39,6 +45,11 @@
 #include "gpio.h"
 #include "motor.h"
 #include "hc_sr04.h"
+#include "sonar.h"
+#include "varredura.h"
+#include "protocolo.h"
+#include "baterias.h"
+#include "telemetria.h"
 
 #ifndef __MSP430FR2355__
 #error "Clock system not supported/tested for this device"
@@ -82,81 +93,247 @@ void init_clock_system(void) {
 }
 
 
-int main(){
-    //const char message[] = "ACK";
-    //const char message_bin_data[] = { 65, 63, 87, 87};
+/* Distância mínima em mm */
+#define DISTANCIA_MINIMA (200)
 
-    //char my_data[8];
+/* Tempo mínimo até a colisão em ms: em velocidade alta o carrinho
+ * freia antes de chegar na distância mínima */
+#define TTC_MINIMO (600)
 
-    /* Desliga Watchdog */
-    WDTCTL = WDTPW + WDTHOLD;
+/* Aproximação do obstáculo à frente, a partir das medições do sensor */
+static struct sonar_aprox_t aproximacao;
 
+/* Número de sequência das mensagens enviadas ao host */
+static uint8_t tx_seq = 0;
 
-#if defined (__MSP430FR2355__)
-    /* Disable the GPIO power-on default high-impedance mode */
-    PM5CTL0 &= ~LOCKLPM5;
+/* Envia uma mensagem do protocolo na fila de prioridade prio
+ * (UART_PRIO_NORMAL ou UART_PRIO_HIGH). Retorna 0 se a fila estiver cheia. */
+static uint8_t envia_mensagem(uint8_t prio, uint8_t id, const uint8_t *payload, uint8_t size){
+
+    if (!proto_encode(uart_tx_ring(UART_A1, prio), id, tx_seq, payload, size))
+        return 0;
+
+    tx_seq++;
+    uart_tx_start(UART_A1);
+
+    return 1;
+}
+
+/* Envia os contadores de uma instância da UART */
+static void envia_estatisticas(uint8_t instancia){
+
+    struct uart_stats_t stats;
+    uint8_t payload[25];
+
+#if UART_USE_UCA0
+    uart_get_stats(instancia ? UART_A1 : UART_A0, &stats);
+#else
+    uart_get_stats(UART_A1, &stats);
 #endif
 
-    /* Inicializa hardware */
-    init_clock_system();
-    /*Inicializacao da UART*/
-    //init_uart();
-    /*Inicializacao dos motores*/
-    //inicializa_motores();
-    /*Inicializacoes do sensor de distancia*/
-    config_timerB_1();
-    config_wd_as_timer();
-    init_sensor();
+    payload[0] = instancia;
+    proto_set_u32(payload + 1, stats.tx_bytes);
+    proto_set_u32(payload + 5, stats.rx_bytes);
+    proto_set_u16(payload + 9, stats.frames);
+    proto_set_u16(payload + 11, stats.overruns);
+    proto_set_u16(payload + 13, stats.framing_errors);
+    proto_set_u16(payload + 15, stats.parity_errors);
+    proto_set_u16(payload + 17, stats.rx_dropped);
+    proto_set_u16(payload + 19, stats.frames_dropped);
+    proto_set_u16(payload + 21, stats.tx_peak);
+    proto_set_u16(payload + 23, stats.rx_peak);
+
+    envia_mensagem(UART_PRIO_NORMAL, PROTO_ID_ESTAT, payload, sizeof(payload));
+}
 
-    volatile uint32_t distancia = 0;
+/* Para o carrinho se houver obstáculo à frente e avisa o host.
+ * distancia: SONAR_MM_INVALIDO se não há medição recente. Sem saber o
+ * que está à frente o carrinho também para (alarme do sensor).
+ * ttc: tempo até a colisão em ms, SONAR_TTC_INFINITO sem aproximação */
+static void verifica_obstaculo(uint16_t distancia, uint16_t ttc){
 
-    __bis_SR_register(GIE);
+    uint8_t payload[3];
 
-    while (1){
+    if (estado_carrinho.direcao != FRENTE)
+        return;
 
+    if (distancia == SONAR_MM_INVALIDO){
+        payload[0] = PROTO_ALARME_SENSOR;
+        proto_set_u16(payload + 1, medicao_timeouts());
+    }
+    else if (distancia < DISTANCIA_MINIMA){
+        payload[0] = PROTO_ALARME_OBSTACULO;
+        proto_set_u16(payload + 1, distancia);
+    }
+    else if (ttc < TTC_MINIMO){
+        payload[0] = PROTO_ALARME_COLISAO;
+        proto_set_u16(payload + 1, ttc);
+    }
+    else
+        return;
 
-        /* Configura o recebimento de um pacote de 4 bytes */
-        //uart_receive_package((uint8_t *)my_data, 1);
+    motor_desligado();
+    envia_mensagem(UART_PRIO_HIGH, PROTO_ID_ALARME, payload, sizeof(payload));
+}
 
-        /* Desliga a CPU enquanto pacote não chega */
-        //__bis_SR_register(CPUOFF | GIE);
-/*
-        switch (my_data[0]) {
-        case 'f':
-            motor_para_frente(1000);  //OBS: a velocidade esta inversamente proporcional
+/* Executa um comando recebido do host e responde com ACK */
+static void trata_mensagem(const struct proto_msg_t *msg){
+
+    uint8_t ack[2] = {msg->seq, PROTO_ACK_OK};
+    uint16_t velocidade;
+
+    switch (msg->id) {
+    case PROTO_ID_MOTOR:
+        if (msg->size != 3){
+            ack[1] = PROTO_ACK_INVALIDO;
             break;
-        case 't':
-            motor_para_tras(1000);
+        }
+
+        /* OBS: a velocidade esta inversamente proporcional */
+        velocidade = proto_get_u16(msg->payload + 1);
+
+        switch (msg->payload[0]) {
+        case PROTO_MOTOR_FRENTE:
+            motor_para_frente(velocidade);
             break;
-        case 'd':
-            motor_para_direita(1000);
+        case PROTO_MOTOR_TRAS:
+            motor_para_tras(velocidade);
             break;
-        case 'e':
-            motor_para_esquerda(1000);
+        case PROTO_MOTOR_DIREITA:
+            motor_para_direita(velocidade);
             break;
-        case 'o':
+        case PROTO_MOTOR_ESQUERDA:
+            motor_para_esquerda(velocidade);
+            break;
+        case PROTO_MOTOR_DESLIGADO:
             motor_desligado();
-
             break;
-
         default:
+            ack[1] = PROTO_ACK_INVALIDO;
+            break;
+        }
+        break;
+
+    case PROTO_ID_PEDE_ESTAT:
+        /* Instância 0 só com a UCA0 habilitada */
+        if (msg->size != 1 || msg->payload[0] > 1 ||
+                (!UART_USE_UCA0 && msg->payload[0] == 0)){
+            ack[1] = PROTO_ACK_INVALIDO;
+            break;
+        }
+
+        envia_estatisticas(msg->payload[0]);
+        break;
+
+    case PROTO_ID_TELEM_CFG:
+        if (msg->size != 2){
+            ack[1] = PROTO_ACK_INVALIDO;
             break;
-        }*/
+        }
+
+        telemetria_periodo(proto_get_u16(msg->payload));
+        break;
+
+    default:
+        ack[1] = PROTO_ACK_INVALIDO;
+        break;
+    }
+
+    /* Envia resposta */
+    envia_mensagem(UART_PRIO_NORMAL, PROTO_ID_ACK, ack, sizeof(ack));
+}
+
+
+int main(){
+    struct proto_decoder_t decoder;
+    struct proto_msg_t msg;
+    uint8_t telemetria[TELEMETRIA_SIZE];
+    uint8_t *frame;
+    uint8_t frame_size;
+
+    /* Desliga Watchdog */
+    WDTCTL = WDTPW + WDTHOLD;
+
 
+#if defined (__MSP430FR2355__)
+    /* Disable the GPIO power-on default high-impedance mode */
+    PM5CTL0 &= ~LOCKLPM5;
+#endif
 
-        /* Envia resposta */
-        //uart_send_package((uint8_t *)message, 4);
+    /* Inicializa hardware */
+    init_clock_system();
+    /*Inicializacao da UART*/
+    init_uart(UART_A1);
+    /* Quadros COBS terminam em 0x00: a UART separa os quadros e só
+     * acorda o main quando um quadro completo chega */
+    uart_frame_mode(UART_A1, UART_FRAME_DELIMITER, 0x00, 0);
+    proto_decoder_init(&decoder);
+    sonar_aprox_init(&aproximacao);
+    /*Inicializacao dos motores*/
+    inicializa_motores();
+    /*Inicializacoes do sensor de distancia*/
+    config_timerB_1();
+    config_wd_as_timer();
+    init_sensor();
+    /*Inicializacao da medicao das baterias*/
+    init_adc();
+
+    struct sonar_amostra_t amostra;
+    /* Sem medição até a primeira amostra do sensor */
+    volatile uint16_t distancia = SONAR_MM_INVALIDO;
+    /* Tempo até a colisão da última amostra: sem eco medido não há
+     * aproximação conhecida */
+    uint16_t ttc = SONAR_TTC_INFINITO;
 
+    __bis_SR_register(GIE);
 
-        /* Aciona o trigger para o sensor funcionar */
-        trigger();
+    while (1){
 
-        /* Entra em modo de economia de energia */
+        /* Processa comandos recebidos: decodifica no próprio buffer
+         * de quadro enquanto a UART recebe o próximo no outro buffer */
+        frame = uart_frame_get(UART_A1, &frame_size);
+        if (frame){
+            if (proto_decode_frame(&decoder, frame, frame_size, &msg))
+                trata_mensagem(&msg);
+            uart_frame_release(UART_A1);
+        }
+
+        /* Entra em modo de economia de energia: acorda a cada medição
+         * do sensor (agendadas pelo Timer B1) e a cada tick do watchdog */
         __bis_SR_register(LPM0_bits + GIE);
 
-       distancia = medicao_distancia();
+       /* Medição nova: mediana das últimas medições, ecos espúrios
+        * isolados não param o carrinho. Distância velha (ecos perdidos
+        * seguidos) já vem como SONAR_MM_INVALIDO */
+       if (medicao_nova(SENSOR_FRENTE, &amostra)){
+#if SONAR_VARREDURA
+           /* Varredura: cada amostra é de um ângulo, a mediana e a
+            * aproximação misturam direções. Distância à frente vem do
+            * setor da frente do mapa polar */
+           distancia = varredura_frente();
+#else
+           distancia = amostra.mm;
+
+           /* Aproximação só com ecos medidos: sem alvo não há o que
+            * se aproxime, distância velha sai pela lacuna de tempo.
+            * Um eco perdido invalida o ttc anterior: um valor velho
+            * abaixo de TTC_MINIMO manteria o carrinho parado.
+            * sonar_aprox_insere() só roda com amostra nova (~25ms), não
+            * a cada volta do loop: veja o custo da divisão em sonar.c */
+           ttc = SONAR_TTC_INFINITO;
+           if (amostra.bruta != SONAR_MM_INVALIDO){
+               sonar_aprox_insere(&aproximacao, amostra.tempo, amostra.bruta);
+               ttc = aproximacao.ttc;
+           }
+           else if (amostra.status == SONAR_SEM_ALVO)
+               sonar_aprox_init(&aproximacao);
+#endif
+       }
+       verifica_obstaculo(distancia, ttc);
 
-        //__bis_SR_register(CPUOFF | GIE);
+       /* Todos os valores em uma mensagem só, a cada período */
+       if (telemetria_tick())
+           envia_mensagem(UART_PRIO_NORMAL, PROTO_ID_TELEMETRIA, telemetria,
+                          telemetria_monta(telemetria, distancia));
     }
 }
-
@@ -1,166 +1,272 @@
 /*
- * 08_main_uart.c
+ * motor.c
  *
- *  Created on: Jun 4, 2020
- *      Author: Renan Augusto Starke
- *      Instituto Federal de Santa Catarina
+ *  Created on: 06/06/2022
+ *  Author: laura
  *
- *
- *      - Exemplo de recepÃ§Ã£o e transmissÃ£o da USART
- *      - CPU Ã© desligado atÃ© o recebimento dos dados.
- *      - Uma mensagem de ACK Ã© enviado quando um pacote
- *      Ã© recebido.
- *
- *      - Clock da CPU Ã© 24MHZ definido e uart_fr2355.h  devido a
- *      configuraÃ§Ã£o do baudrate.
- *
- *      - VEJA uart_fr2355.c/.h
- *
- *               MSP430FR2355
- *            -----------------
- *        /|\|              XIN|-
- *         | |                 |
- *         --|RST          XOUT|-
- *           |                 |
- *           |    P4.3/UCA1TXD | --> TX
- *           |                 |
- *           |    P4.2/UCA1RXD | <-- RX
- *           |                 |
+ *  - Direções em uma tabela constante (FRAM): modos de TB3CCTL1..4 de
+ *    cada direção, aplicados todos de uma vez.
+ *  - Direção e velocidade novas são trocadas pela ISR do Timer B3 no
+ *    fundo da contagem up/down (TB3R = 0). Ali todas as saídas estão
+ *    em nível baixo: a ponte H não vê estados intermediários entre as
+ *    escritas nem pulsos cortados, e os dois lados de um motor nunca
+ *    ficam ligados juntos.
  */
 
-
-/* System includes */
 #include <msp430.h>
 #include <stdint.h>
 
-/* Project includes */
-#include "uart_fr2355.h"
-#include "bits.h"
-#include "gpio.h"
 #include "motor.h"
-#include "hc_sr04.h"
 
-#ifndef __MSP430FR2355__
-#error "Clock system not supported/tested for this device"
-#endif
 
+void config_timerB_3_as_pwm();
+
+volatile struct estado_motores estado_carrinho = {DESLIGADO, 0};
+
+/* Modos das saídas TB3.1 a TB3.4 de cada direção, na ordem do enum de
+ * motor.h. TB3.1/TB3.2 e TB3.3/TB3.4 são os dois lados de cada motor.
+ * Saídas em OUTMOD_0 ignoram o comparador: todos recebem a velocidade */
+struct motor_modo_t {
+    uint16_t cctl[4];
+};
+
+static const struct motor_modo_t modos[] = {
+    /* DESLIGADO */ {{OUTMOD_0, OUTMOD_0, OUTMOD_0, OUTMOD_0}},
+    /* FRENTE    */ {{OUTMOD_6, OUTMOD_0, OUTMOD_6, OUTMOD_0}},
+    /* TRAS      */ {{OUTMOD_0, OUTMOD_6, OUTMOD_0, OUTMOD_6}},
+    /* ESQUERDA  */ {{OUTMOD_0, OUTMOD_6, OUTMOD_6, OUTMOD_0}},
+    /* DIREITA   */ {{OUTMOD_6, OUTMOD_0, OUTMOD_0, OUTMOD_6}},
+};
+
+/* Próxima direção e velocidade: aplicadas pela ISR do Timer B3 */
+static volatile uint8_t direcao_pendente = DESLIGADO;
+static volatile uint16_t velocidade_pendente = 0;
 
 
-/**
-  * Configura sistema de clock para usar o Digitally Controlled Oscillator (DCO) em 24MHz
-  * Essa configuraÃ§Ã£o utiliza pinos para cristal externo.
-  */
-void init_clock_system(void) {
-
-    // Configure two FRAM wait state as required by the device data sheet for MCLK
-    // operation at 24MHz(beyond 8MHz) _before_ configuring the clock system.
-    FRCTL0 = FRCTLPW | NWAITS_2 ;
-
-    P2SEL1 |= BIT6 | BIT7;                       // P2.6~P2.7: crystal pins
-    do
-    {
-        CSCTL7 &= ~(XT1OFFG | DCOFFG);           // Clear XT1 and DCO fault flag
-        SFRIFG1 &= ~OFIFG;
-    } while (SFRIFG1 & OFIFG);                   // Test oscillator fault flag
-
-    __bis_SR_register(SCG0);                     // disable FLL
-    CSCTL3 |= SELREF__XT1CLK;                    // Set XT1 as FLL reference source
-    CSCTL0 = 0;                                  // clear DCO and MOD registers
-    CSCTL1 = DCORSEL_7;                          // Set DCO = 24MHz
-    CSCTL2 = FLLD_0 + 731;                       // DCOCLKDIV = 327358*731 / 1
-    __delay_cycles(3);
-    __bic_SR_register(SCG0);                     // enable FLL
-    while(CSCTL7 & (FLLUNLOCK0 | FLLUNLOCK1));   // FLL locked
-
-    /* CSCTL4 = SELMS__DCOCLKDIV | SELA__REFOCLK;
-     * set XT1 (~32768Hz) as ACLK source, ACLK = 32768Hz
-     * default DCOCLKDIV as MCLK and SMCLK source
-     - Selects the ACLK source.
-     * 00b = XT1CLK with divider (must be no more than 40 kHz)
-     * 01b = REFO (internal 32-kHz clock source)
-     * 10b = VLO (internal 10-kHz clock source) (1)   */
-    CSCTL4 = SELMS__DCOCLKDIV | SELA__REFOCLK;
+/*
+ * Configura temporizador B3 com contagem up e down.
+ */
+void config_timerB_3_as_pwm(){
+
+    /* Estamos usando TB3CCR0 para contagem máxima
+     * que permite controle preciso sobre o período
+     * é possível usar o overflow */
+
+    /* Configuração dos comparadores como PWM:
+     *
+     * TB3CCR0: Timer3_B Capture/Compare 0: período do PWM
+     *
+     * OUTMOD_2: PWM output mode: 2 - PWM toggle/reset
+     *
+     * TB3CCR1 PWM duty cycle: TB3CCR1 / TB3CCR0 *
+     * TA2CCR1 PWM duty cycle: TA2CCR1 / TA1CCR0 */
+
+    TB3CCR0 = CONTAGEM_MAX_CCR-1;
+
+
+    /*      .
+     *      /|\                  +                < -Comparador 0: (máximo da contagem) -> período do PWM
+     *       |                 +   +
+     *       |               +       +
+     *       |-------------+---------- +          <--  Comparadores 1 e 2: razão cíclica
+     *       |           +  |         | +
+     *       |         +    |         |   +
+     *       |       +      |         |     +
+     *       |     +        |         |       +
+     *       |   +          |         |         +
+     *       | +            |         |           +
+     * Timer +--------------|---- ----|-------------->
+     *       |              |
+     *       |
+     *
+     *       |--------------+         |--------------
+     * Saída |              |         |
+     *       +---------------++++++++++------------->
+     */
+
+    /* TBSSEL_2 -> Timer B clock source select: 2 - SMCLK
+     * MC_1     -> Timer B mode control: 1 - Up to CCR0
+     * ID_3     ->  Timer B input divider: 3 - /8
+     *
+     * Configuração da fonte do clock do timer 1 */
+    TB3CTL = TBSSEL_2 | MC_3 | ID_0;
 }
 
+void inicializa_motores(){
 
-int main(){
-    //const char message[] = "ACK";
-    //const char message_bin_data[] = { 65, 63, 87, 87};
+    config_timerB_3_as_pwm();
 
-    //char my_data[8];
 
-    /* Desliga Watchdog */
-    WDTCTL = WDTPW + WDTHOLD;
+    /* Ligação físicas do timer nas portas */
+    /* TB3.1 é o P6.0
+     * TB3.2 é o P6.1
+     *
+     * P6.0 e P6.1 geram mesmo sinal PWM
+     *
+     * TB3.3 é o P6.2
+     * TB3.4 é o P6.3
+     *
+     * P6.2 e P6.3 geram mesmo sinal PWM
+     *
+     * */
+    P6DIR = BIT0 | BIT1 | BIT2 | BIT3;
 
+    P6OUT = 0;
 
-#if defined (__MSP430FR2355__)
-    /* Disable the GPIO power-on default high-impedance mode */
-    PM5CTL0 &= ~LOCKLPM5;
-#endif
+    /* Função alternativa: ligação dos pinos no temporizador
+     *
+     * P6.0 -> TB3.1
+     * P6.1 -> TB3.2
+     * P6.2 -> TB3.3
+     * P6.3 -> TB3.4
+     * */
+    P6SEL0 = BIT0 | BIT1 | BIT2 | BIT3;
 
-    /* Inicializa hardware */
-    init_clock_system();
-    /*Inicializacao da UART*/
-    //init_uart();
-    /*Inicializacao dos motores*/
-    //inicializa_motores();
-    /*Inicializacoes do sensor de distancia*/
-    config_timerB_1();
-    config_wd_as_timer();
-    init_sensor();
+}
 
+/* Agenda a troca de direção e velocidade para o próximo fundo da
+ * contagem do Timer B3. Chamadas seguidas antes dele: vale a última */
+static void motor_aplica(uint8_t direcao, uint16_t x){
 
-    volatile uint32_t distancia = 0;
+    uint16_t state = __get_interrupt_state();
 
-    __bis_SR_register(GIE);
+    __disable_interrupt();
 
-    while (1){
+    direcao_pendente = direcao;
+    velocidade_pendente = x;
 
+    estado_carrinho.direcao = direcao;
+    estado_carrinho.velocidade = x;
 
-        /* Configura o recebimento de um pacote de 4 bytes */
-        //uart_receive_package((uint8_t *)my_data, 1);
+    /* TBIFG é marcado a cada período: o velho é descartado para a
+     * troca esperar o próximo fundo */
+    TB3CTL &= ~TBIFG;
+    TB3CTL |= TBIE;
 
-        /* Desliga a CPU enquanto pacote nÃ£o chega */
-        //__bis_SR_register(CPUOFF | GIE);
-/*
-        switch (my_data[0]) {
-        case 'f':
-            motor_para_frente(1000);  //OBS: a velocidade esta inversamente proporcional
-            break;
-        case 't':
-            motor_para_tras(1000);
-            break;
-        case 'd':
-            motor_para_direita(1000);
-            break;
-        case 'e':
-            motor_para_esquerda(1000);
-            break;
-        case 'o':
-            motor_desligado();
+    __set_interrupt_state(state);
+}
 
-            break;
+void motor_para_frente(uint16_t x){
+    motor_aplica(FRENTE, x);
+}
 
-        default:
-            break;
-        }*/
+void motor_para_tras(uint16_t x){
+    motor_aplica(TRAS, x);
+}
 
+void motor_para_direita(uint16_t x){
+    motor_aplica(DIREITA, x);
+}
 
-        /* Envia resposta */
-        //uart_send_package((uint8_t *)message, 4);
 
+void motor_para_esquerda(uint16_t x){
+    motor_aplica(ESQUERDA, x);
+}
 
-        /* Aciona o trigger para o sensor funcionar */
-        trigger();
+void motor_desligado(){
+    motor_aplica(DESLIGADO, 0);
+}
+
+/* Muda a razao ciclica para + 10% do valor máximo (8000)*/
+void muda_razao_ciclica(){
 
-        /* Entra em modo de economia de energia */
-        __bis_SR_register(LPM0_bits + GIE);
+    estado_carrinho.velocidade = estado_carrinho.velocidade - 800;
 
-       distancia = medicao_distancia();
+    if (estado_carrinho.velocidade > CONTAGEM_MAX_CCR){
+        estado_carrinho.velocidade = 6000;
+    }
 
-        //__bis_SR_register(CPUOFF | GIE);
+    switch(estado_carrinho.direcao){
+    case FRENTE:
+        motor_para_frente(estado_carrinho.velocidade);
+        break;
+    case TRAS:
+        motor_para_tras(estado_carrinho.velocidade);
+        break;
+    case DIREITA:
+        motor_para_direita(estado_carrinho.velocidade);
+        break;
+    case ESQUERDA:
+        motor_para_esquerda(estado_carrinho.velocidade);
+        break;
+    default:
+        break;
     }
 }
 
 
+void muda_sentido(){
+
+    switch (estado_carrinho.direcao) {
+    case DESLIGADO:
+        motor_para_frente(4000);
+        break;
+    case FRENTE:
+        motor_para_tras(4000);
+        break;
+    case TRAS:
+        motor_para_direita(4000);
+        break;
+    case DIREITA:
+        motor_para_esquerda(4000);
+        break;
+    case ESQUERDA:
+        motor_desligado();
+        break;
+
+    default:
+        break;
+    }
+
+
+}
+
 
+/* ISR1 do Timer B3: TBIFG no fundo da contagem up/down (TB3R = 0).
+ *
+ *  TB3R  CCR0 ... x ... 0 ... x ... CCR0
+ *  OUTMOD_6    alto | baixo   | alto
+ *                         ^
+ *                    troca aqui
+ *
+ * Com OUTMOD_6 as saídas estão em nível baixo entre a descida e a
+ * subida pelo comparador: modos e comparadores novos valem a partir da
+ * subida deste período. A janela em nível baixo dura 2 * x contagens
+ * (x: velocidade), bem mais que a latência da ISR nas velocidades
+ * usadas. Depois da troca a interrupção é desligada. */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER3_B1_VECTOR
+__interrupt void TIMER3_B1_ISR (void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER3_B1_VECTOR))) TIMER3_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    const struct motor_modo_t *modo;
+    uint16_t x;
+
+    switch(__even_in_range(TB3IV, TBxIV_TBIFG)){
+
+    /* Vector 10:  TBIFG -> Fundo da contagem */
+    case TBxIV_TBIFG:
+        modo = &modos[direcao_pendente];
+        x = velocidade_pendente;
+
+        TB3CCR1 = x;
+        TB3CCR2 = x;
+        TB3CCR3 = x;
+        TB3CCR4 = x;
+
+        TB3CCTL1 = modo->cctl[0];
+        TB3CCTL2 = modo->cctl[1];
+        TB3CCTL3 = modo->cctl[2];
+        TB3CCTL4 = modo->cctl[3];
+
+        TB3CTL &= ~TBIE;
+        break;
+
+    default:
+        break;
+    }
+}
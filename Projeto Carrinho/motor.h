@@ -8,8 +8,20 @@
 #ifndef MOTOR_H_
 #define MOTOR_H_
 
+#include <stdint.h>
+
 #define CONTAGEM_MAX_CCR 8000
 
+enum {DESLIGADO, FRENTE, TRAS, ESQUERDA, DIREITA};
+
+struct estado_motores{
+    uint8_t direcao;
+    uint16_t velocidade;
+};
+
+/* Direção e velocidade atuais: alterado somente por motor.c */
+extern volatile struct estado_motores estado_carrinho;
+
 
 void inicializa_motores();
 
@@ -0,0 +1,338 @@
+/*
+ *  Modulo: protocolo.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Codificação e decodificação do protocolo binário
+ *  (COBS + CRC-16) diretamente nos buffers circulares da UART.
+ *  Veja protocolo.h para o formato do quadro.
+ *
+ *  - Codificação: os bytes são escritos direto no buffer de transmissão.
+ *    O código de cada bloco COBS é reservado e preenchido quando o bloco
+ *    termina. O quadro só é publicado para a ISR quando está completo.
+ *  - Decodificação: os bytes são retirados do buffer de recepção e
+ *    decodificados um a um, sem copiar o quadro codificado.
+ *    Quadros já separados pela UART (delimitador 0x00) também podem ser
+ *    decodificados no próprio buffer com proto_decode_frame().
+ */
+
+/* Tipos uint16_t, uint8_t, ... */
+#include <stdint.h>
+
+#include "ring_buffer.h"
+#include "protocolo.h"
+
+/* Tabela do CRC-16/CCITT (polinômio 0x1021): constante, fica na FRAM */
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+static inline uint16_t crc16_update(uint16_t crc, uint8_t data){
+    return (crc << 8) ^ crc16_table[(crc >> 8) ^ data];
+}
+
+/**
+ * @brief  Calcula o CRC-16/CCITT de um bloco de dados.
+ *
+ * @param  data: endereço inicial dos dados.
+ *         size: tamanho dos dados.
+ *         crc: valor inicial (0xFFFF para um novo cálculo).
+ *
+ * @retval CRC calculado.
+ */
+uint16_t crc16(const uint8_t *data, uint16_t size, uint16_t crc){
+
+    while (size--)
+        crc = crc16_update(crc, *data++);
+
+    return crc;
+}
+
+
+/* Estado do codificador COBS escrevendo no buffer circular */
+struct cobs_encoder_t {
+    struct ring_t *ring;
+    /* Posição reservada para o código do bloco atual */
+    uint16_t code_pos;
+    /* Próxima posição de escrita */
+    uint16_t pos;
+    /* Código do bloco atual: quantidade de bytes + 1 */
+    uint8_t code;
+};
+
+static inline void cobs_close_block(struct cobs_encoder_t *enc){
+    enc->ring->buffer[enc->code_pos & enc->ring->mask] = enc->code;
+    enc->code_pos = enc->pos++;
+    enc->code = 1;
+}
+
+static inline void cobs_put(struct cobs_encoder_t *enc, uint8_t data){
+
+    if (data == 0){
+        cobs_close_block(enc);
+        return;
+    }
+
+    enc->ring->buffer[enc->pos++ & enc->ring->mask] = data;
+
+    /* Bloco máximo de 254 bytes sem zero */
+    if (++enc->code == 0xff)
+        cobs_close_block(enc);
+}
+
+/**
+ * @brief  Codifica uma mensagem e a coloca no buffer de transmissão.
+ *         Não bloqueia: se não houver espaço a mensagem não é enviada.
+ *
+ * @param  ring: buffer circular de transmissão.
+ *         id: tipo da mensagem (PROTO_ID_*).
+ *         seq: número de sequência.
+ *         payload: dados da mensagem.
+ *         size: tamanho dos dados (até PROTO_MAX_PAYLOAD).
+ *
+ * @retval 1 se a mensagem foi colocada no buffer, 0 caso contrário.
+ */
+uint8_t proto_encode(struct ring_t *ring, uint8_t id, uint8_t seq,
+                     const uint8_t *payload, uint8_t size){
+
+    struct cobs_encoder_t enc;
+    uint16_t crc = 0xffff;
+    uint8_t i;
+
+    if (size > PROTO_MAX_PAYLOAD || ring_free(ring) < size + 6)
+        return 0;
+
+    enc.ring = ring;
+    enc.code_pos = ring->head;
+    enc.pos = ring->head + 1;
+    enc.code = 1;
+
+    crc = crc16_update(crc, id);
+    cobs_put(&enc, id);
+    crc = crc16_update(crc, seq);
+    cobs_put(&enc, seq);
+
+    for (i = 0; i < size; i++){
+        crc = crc16_update(crc, payload[i]);
+        cobs_put(&enc, payload[i]);
+    }
+
+    cobs_put(&enc, crc >> 8);
+    cobs_put(&enc, crc & 0xff);
+
+    /* Último bloco e delimitador */
+    ring->buffer[enc.code_pos & ring->mask] = enc.code;
+    ring->buffer[enc.pos++ & ring->mask] = 0;
+
+    /* Publica o quadro completo para a ISR */
+    ring->head = enc.pos;
+
+    return 1;
+}
+
+
+/**
+ * @brief  Inicializa o decodificador: descarta bytes até o primeiro
+ *         delimitador, pois a recepção pode começar no meio de um quadro.
+ */
+void proto_decoder_init(struct proto_decoder_t *dec){
+    dec->size = 0;
+    dec->remaining = 0;
+    dec->code = 0xff;
+    dec->discard = 1;
+    dec->synced = 0;
+    dec->crc_errors = 0;
+    dec->framing_errors = 0;
+    dec->lost = 0;
+    dec->duplicates = 0;
+}
+
+/* Valida um quadro decodificado e preenche a mensagem */
+static uint8_t proto_frame_check(struct proto_decoder_t *dec, const uint8_t *frame,
+                                 uint8_t size, struct proto_msg_t *msg){
+
+    if (size < 4){
+        dec->framing_errors++;
+        return 0;
+    }
+
+    /* CRC sobre dados + CRC recebido resulta em zero */
+    if (crc16(frame, size, 0xffff) != 0){
+        dec->crc_errors++;
+        return 0;
+    }
+
+    msg->id = frame[0];
+    msg->seq = frame[1];
+    msg->size = size - 4;
+    msg->payload = &frame[2];
+
+    /* Saltos na sequência indicam mensagens perdidas. Mensagens de
+     * alta prioridade podem passar à frente de outras já na fila: uma
+     * mensagem atrasada (seq anterior) desconta a perda contada antes.
+     * Seq repetido é uma retransmissão: não há perda */
+    if (dec->synced){
+        uint8_t diff = (uint8_t)(msg->seq - dec->last_seq);
+
+        if (diff == 0){
+            dec->duplicates++;
+            return 1;
+        }
+        if (diff >= 0x80){
+            if (dec->lost)
+                dec->lost--;
+            return 1;
+        }
+        dec->lost += (uint8_t)(diff - 1);
+    }
+    dec->last_seq = msg->seq;
+    dec->synced = 1;
+
+    return 1;
+}
+
+/* Armazena um byte decodificado: quadro longo demais é descartado */
+static inline uint8_t frame_push(struct proto_decoder_t *dec, uint8_t data){
+
+    if (dec->size == PROTO_MAX_FRAME){
+        dec->framing_errors++;
+        dec->discard = 1;
+        return 0;
+    }
+
+    dec->frame[dec->size++] = data;
+    return 1;
+}
+
+/**
+ * @brief  Retira bytes do buffer de recepção até completar uma mensagem
+ *         válida ou esvaziar o buffer. Não bloqueia.
+ *
+ * @param  dec: estado do decodificador.
+ *         ring: buffer circular de recepção.
+ *         msg: mensagem decodificada.
+ *
+ * @retval 1 se msg contém uma mensagem válida, 0 caso contrário.
+ */
+uint8_t proto_decode(struct proto_decoder_t *dec, struct ring_t *ring,
+                     struct proto_msg_t *msg){
+
+    while (!ring_empty(ring)){
+        uint8_t data = ring_get(ring);
+
+        /* Delimitador: fim do quadro */
+        if (data == 0){
+            uint8_t ok = 0;
+
+            /* Quadro terminado antes do fim do bloco COBS */
+            if (dec->remaining && !dec->discard){
+                dec->framing_errors++;
+                dec->discard = 1;
+            }
+
+            if (!dec->discard)
+                ok = proto_frame_check(dec, dec->frame, dec->size, msg);
+
+            dec->size = 0;
+            dec->remaining = 0;
+            dec->code = 0xff;
+            dec->discard = 0;
+
+            if (ok)
+                return 1;
+            continue;
+        }
+
+        if (dec->discard)
+            continue;
+
+        /* Início de bloco: data é o código do bloco. O zero implícito
+         * do bloco anterior é inserido, exceto no primeiro bloco e após
+         * um bloco de 254 bytes (código 0xFF) */
+        if (dec->remaining == 0){
+            if (dec->code != 0xff && !frame_push(dec, 0))
+                continue;
+
+            dec->code = data;
+            dec->remaining = data - 1;
+            continue;
+        }
+
+        if (!frame_push(dec, data))
+            continue;
+
+        dec->remaining--;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  Decodifica no próprio buffer um quadro já separado pela UART
+ *         (sem o delimitador 0x00). O buffer é sobrescrito: a saída COBS
+ *         nunca é maior que a entrada, então não há cópia.
+ *
+ * @param  dec: estado do decodificador (contadores de erro e sequência).
+ *         frame: quadro codificado, alterado no lugar.
+ *         size: tamanho do quadro codificado.
+ *         msg: mensagem decodificada, com dados apontando para frame.
+ *
+ * @retval 1 se msg contém uma mensagem válida, 0 caso contrário.
+ */
+uint8_t proto_decode_frame(struct proto_decoder_t *dec, uint8_t *frame,
+                           uint8_t size, struct proto_msg_t *msg){
+
+    uint8_t in = 0;
+    uint8_t out = 0;
+    uint8_t i;
+
+    while (in < size){
+        uint8_t code = frame[in++];
+
+        /* Código zero ou bloco além do fim do quadro */
+        if (code == 0 || code - 1 > size - in){
+            dec->framing_errors++;
+            return 0;
+        }
+
+        for (i = 1; i < code; i++)
+            frame[out++] = frame[in++];
+
+        /* Zero implícito, exceto no fim do quadro e após bloco de 254 bytes */
+        if (code != 0xff && in < size)
+            frame[out++] = 0;
+    }
+
+    return proto_frame_check(dec, frame, out, msg);
+}
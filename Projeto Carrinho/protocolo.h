@@ -0,0 +1,140 @@
+/*
+ *  Modulo: protocolo.h
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Protocolo binário de comandos e telemetria do carrinho.
+ *  Código portável: usado no MSP430 e nos programas do host (Linux).
+ *
+ *  Quadro antes da codificação:
+ *
+ *      +----+-----+-----------------+--------+--------+
+ *      | id | seq | dados (0 a 24)  | CRC Hi | CRC Lo |
+ *      +----+-----+-----------------+--------+--------+
+ *
+ *  - id: tipo da mensagem (PROTO_ID_*).
+ *  - seq: número de sequência de cada lado, incrementado a cada
+ *    mensagem enviada. Saltos indicam mensagens perdidas. Alarmes
+ *    (alta prioridade) podem chegar antes de mensagens com seq menor.
+ *  - CRC-16/CCITT (polinômio 0x1021, início 0xFFFF) de id, seq e dados,
+ *    enviado com o byte mais significativo primeiro.
+ *  - Campos de 16 e 32 bits dos dados são little-endian.
+ *
+ *  O quadro é codificado em COBS (Consistent Overhead Byte Stuffing)
+ *  e terminado por 0x00. Como o byte 0x00 nunca aparece dentro do
+ *  quadro codificado, o receptor sempre ressincroniza no próximo zero.
+ */
+
+#ifndef PROTOCOLO_H_
+#define PROTOCOLO_H_
+
+#include <stdint.h>
+#include "ring_buffer.h"
+
+/* Tamanho máximo dos dados de uma mensagem */
+#define PROTO_MAX_PAYLOAD (26)
+/* id + seq + dados + CRC */
+#define PROTO_MAX_FRAME (PROTO_MAX_PAYLOAD + 4)
+/* Pior caso no buffer: 1 byte de overhead COBS + delimitador */
+#define PROTO_MAX_ENCODED (PROTO_MAX_FRAME + 2)
+
+/* Tipos de mensagem: host -> carrinho */
+#define PROTO_ID_MOTOR      (0x01)  /* u8 direção, u16 velocidade */
+#define PROTO_ID_PEDE_ESTAT (0x02)  /* u8 instância da UART (0: UCA0, 1: UCA1) */
+#define PROTO_ID_TELEM_CFG  (0x03)  /* u16 período da telemetria em ticks (0 desliga) */
+
+/* Tipos de mensagem: carrinho -> host */
+#define PROTO_ID_ACK        (0x80)  /* u8 seq recebido, u8 status */
+#define PROTO_ID_DISTANCIA  (0x81)  /* u32 distância em mm */
+#define PROTO_ID_BATERIA    (0x82)  /* u16 bateria 1, u16 bateria 2 */
+#define PROTO_ID_ESTAT      (0x83)  /* u8 instância, u32 bytes enviados,
+                                     * u32 bytes recebidos, u16 quadros,
+                                     * u16 overruns, u16 erros de framing,
+                                     * u16 erros de paridade, u16 bytes
+                                     * descartados, u16 quadros descartados,
+                                     * u16 pico TX, u16 pico RX */
+#define PROTO_ID_ALARME     (0x84)  /* u8 tipo, u16 valor (alta prioridade) */
+#define PROTO_ID_TELEMETRIA (0x85)  /* u16 tempo em ticks, u16 distância (mm),
+                                     * u16 bateria 1, u16 bateria 2,
+                                     * u8 direção, u16 velocidade */
+
+/* Direções de PROTO_ID_MOTOR */
+#define PROTO_MOTOR_DESLIGADO (0)
+#define PROTO_MOTOR_FRENTE    (1)
+#define PROTO_MOTOR_TRAS      (2)
+#define PROTO_MOTOR_ESQUERDA  (3)
+#define PROTO_MOTOR_DIREITA   (4)
+
+/* Tipos de PROTO_ID_ALARME */
+#define PROTO_ALARME_OBSTACULO (0)  /* valor: distância medida */
+#define PROTO_ALARME_BATERIA   (1)  /* valor: leitura do ADC */
+#define PROTO_ALARME_SENSOR    (2)  /* valor: timeouts do sensor de distância */
+#define PROTO_ALARME_COLISAO   (3)  /* valor: tempo até a colisão (ms) */
+
+/* Status de PROTO_ID_ACK */
+#define PROTO_ACK_OK          (0)
+#define PROTO_ACK_INVALIDO    (1)
+
+/* Mensagem decodificada: dados apontam para dentro do decodificador
+ * e são válidos até a próxima chamada de proto_decode() */
+struct proto_msg_t {
+    uint8_t id;
+    uint8_t seq;
+    uint8_t size;
+    const uint8_t *payload;
+};
+
+/* Estado do decodificador COBS de fluxo contínuo */
+struct proto_decoder_t {
+    uint8_t frame[PROTO_MAX_FRAME];
+    uint8_t size;
+    /* Bytes restantes no bloco COBS atual */
+    uint8_t remaining;
+    /* Código do bloco atual: 0xFF não insere zero no final */
+    uint8_t code;
+    /* Quadro inválido: descarta até o próximo delimitador */
+    uint8_t discard;
+
+    /* Detecção de perdas */
+    uint8_t last_seq;
+    uint8_t synced;
+
+    /* Contadores de erros */
+    uint16_t crc_errors;
+    uint16_t framing_errors;
+    uint16_t lost;
+    /* Mesmo seq da mensagem anterior (retransmissão) */
+    uint16_t duplicates;
+};
+
+uint16_t crc16(const uint8_t *data, uint16_t size, uint16_t crc);
+
+uint8_t proto_encode(struct ring_t *ring, uint8_t id, uint8_t seq,
+                     const uint8_t *payload, uint8_t size);
+
+void proto_decoder_init(struct proto_decoder_t *dec);
+uint8_t proto_decode(struct proto_decoder_t *dec, struct ring_t *ring,
+                     struct proto_msg_t *msg);
+uint8_t proto_decode_frame(struct proto_decoder_t *dec, uint8_t *frame,
+                           uint8_t size, struct proto_msg_t *msg);
+
+/* Leitura e escrita de campos little-endian */
+static inline uint16_t proto_get_u16(const uint8_t *p){
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t proto_get_u32(const uint8_t *p){
+    return (uint32_t)proto_get_u16(p) | ((uint32_t)proto_get_u16(p + 2) << 16);
+}
+
+static inline void proto_set_u16(uint8_t *p, uint16_t v){
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static inline void proto_set_u32(uint8_t *p, uint32_t v){
+    proto_set_u16(p, v & 0xffff);
+    proto_set_u16(p + 2, v >> 16);
+}
+
+#endif /* PROTOCOLO_H_ */
@@ -0,0 +1,107 @@
+/*
+ *  Modulo: ring_buffer.h
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Buffer circular de bytes para um produtor e um consumidor
+ *  (ex.: main escreve e a ISR lê, ou o contrário).
+ *
+ *  - Tamanho do buffer deve ser potência de 2: o índice é obtido com
+ *    uma máscara ao invés de divisão.
+ *  - head e tail contam livremente (16 bits) e só são alterados pelo
+ *    seu dono: head pelo produtor, tail pelo consumidor. No MSP430 a
+ *    escrita de 16 bits é atômica, portanto não é preciso desligar IRQs.
+ */
+
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+
+struct ring_t {
+    uint8_t *buffer;
+    uint16_t mask;
+    /* Índice de escrita: alterado somente pelo produtor */
+    volatile uint16_t head;
+    /* Índice de leitura: alterado somente pelo consumidor */
+    volatile uint16_t tail;
+};
+
+/* Inicializador estático: buf deve ser um vetor (não ponteiro) */
+#define RING_INIT(buf) { (buf), sizeof(buf) - 1, 0, 0 }
+
+/* Verificação do tamanho em tempo de compilação */
+#define RING_SIZE_IS_POW2(size) (((size) != 0) && (((size) & ((size) - 1)) == 0))
+
+/* Quantidade de bytes armazenados */
+static inline uint16_t ring_count(const struct ring_t *r){
+    return (uint16_t)(r->head - r->tail);
+}
+
+/* Espaço livre em bytes */
+static inline uint16_t ring_free(const struct ring_t *r){
+    return (uint16_t)(r->mask + 1 - ring_count(r));
+}
+
+static inline uint8_t ring_empty(const struct ring_t *r){
+    return r->head == r->tail;
+}
+
+/* Insere um byte. Chamador deve verificar ring_free() antes. */
+static inline void ring_put(struct ring_t *r, uint8_t data){
+    r->buffer[r->head & r->mask] = data;
+    r->head++;
+}
+
+/* Retira um byte. Chamador deve verificar ring_empty() antes. */
+static inline uint8_t ring_get(struct ring_t *r){
+    uint8_t data = r->buffer[r->tail & r->mask];
+    r->tail++;
+    return data;
+}
+
+/**
+ * @brief  Copia até size bytes para o buffer, limitado ao espaço livre.
+ *
+ * @retval quantidade de bytes efetivamente inseridos.
+ */
+static inline uint16_t ring_write(struct ring_t *r, const uint8_t *data, uint16_t size){
+    uint16_t head = r->head;
+    uint16_t n = ring_free(r);
+    uint16_t i;
+
+    if (size < n)
+        n = size;
+
+    for (i = 0; i < n; i++)
+        r->buffer[(head + i) & r->mask] = data[i];
+
+    /* Publica os dados de uma vez só para o consumidor */
+    r->head = head + n;
+
+    return n;
+}
+
+/**
+ * @brief  Copia até size bytes do buffer, limitado ao que está armazenado.
+ *
+ * @retval quantidade de bytes efetivamente retirados.
+ */
+static inline uint16_t ring_read(struct ring_t *r, uint8_t *data, uint16_t size){
+    uint16_t tail = r->tail;
+    uint16_t n = ring_count(r);
+    uint16_t i;
+
+    if (size < n)
+        n = size;
+
+    for (i = 0; i < n; i++)
+        data[i] = r->buffer[(tail + i) & r->mask];
+
+    /* Libera o espaço de uma vez só para o produtor */
+    r->tail = tail + n;
+
+    return n;
+}
+
+#endif /* RING_BUFFER_H_ */
@@ -0,0 +1,706 @@
+/*
+ *  Modulo: sonar.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Máquina de estados da captura do eco do HC-SR04.
+ *
+ *  - O estado das bordas é mantido entre as interrupções: a borda de
+ *    subida é guardada até a descida chegar.
+ *  - Os tempos são de 32 bits (Timer B1 estendido pelas voltas, veja
+ *    hc_sr04.c): a subtração não tem erro quando o timer dá a volta
+ *    durante o eco.
+ *
+ *         disparo       subida          descida
+ *    OCIOSO ----> ESPERA_SUBIDA ----> ESPERA_DESCIDA ----> OCIOSO
+ *                                                largura, SONAR_VALIDA
+ *
+ *  - Borda perdida (COV ou nível incoerente): conta um erro e volta
+ *    para OCIOSO sem publicar uma distância errada.
+ *  - Eco que não termina em SONAR_TIMEOUT (sonar_timeout, chamado pelo
+ *    comparador do timer): conta um timeout e volta para OCIOSO.
+ *  - Eco de largura máxima: SONAR_SEM_ALVO, o caminho está livre.
+ *  - A distância filtrada vale enquanto a última medição com eco for
+ *    recente (sonar_recente): medições perdidas seguidas a deixam velha.
+ *  - Toda medição terminada é publicada para o main em sonar->publicada
+ *    com um contador de geração (seqlock, um produtor e um consumidor):
+ *    o main lê sem desabilitar interrupções e sabe se a amostra é nova.
+ *  - O fim da medição agenda o próximo disparo (sonar_proximo): rápido
+ *    com obstáculos por perto, lento com o caminho livre e parado.
+ *  - Com vários sensores o próximo é escolhido em rodízio (sonar_rodizio)
+ *    com intervalo de guarda: um eco de cada vez.
+ *  - Agendamento dos disparos no comparador 0 do timer (sonar_agenda,
+ *    sonar_comparador): decide o que a ISR0 de hc_sr04.c programa.
+ *  - Velocidade de aproximação e tempo até a colisão (sonar_aprox_insere)
+ *    a partir das amostras publicadas: executado pelo main, fora da ISR.
+ *
+ *  - Cada medição válida é convertida e passa pelo filtro de mediana
+ *    com rejeição de outliers (sonar_filtro_insere).
+ *  - Conversão de contagens para milímetros por multiplicação e
+ *    deslocamento (sonar_mm), com compensação opcional da velocidade
+ *    do som pela temperatura (sonar_temperatura).
+ *
+ *  Código portável: não usa registradores do MSP430.
+ */
+
+#include <stdint.h>
+
+#include "sonar.h"
+
+/* mm por contagem do timer em Q16: compartilhado pelos sensores */
+static uint16_t escala = (SONAR_K0 + SONAR_TEMPERATURA * SONAR_K1) >> 8;
+
+void sonar_init(struct sonar_t *sonar){
+    sonar->estado = SONAR_OCIOSO;
+    sonar->disparo = 0;
+    sonar->subida = 0;
+    sonar->fim = 0;
+    sonar->calmas = 0;
+    sonar->largura = 0;
+    sonar->status = SONAR_NENHUMA;
+    sonar->amostra = 0;
+    sonar->erros = 0;
+    sonar->timeouts = 0;
+    sonar->publicada.largura = 0;
+    sonar->publicada.tempo = 0;
+    sonar->publicada.mm = SONAR_MM_INVALIDO;
+    sonar->publicada.bruta = SONAR_MM_INVALIDO;
+    sonar->publicada.status = SONAR_NENHUMA;
+    sonar->geracao = 0;
+    sonar_filtro_init(&sonar->filtro);
+}
+
+/**
+ * @brief  Prepara uma nova medição: chamado junto com o trigger.
+ *
+ * @param  sonar: estado do sensor.
+ *         tempo: início do pulso de trigger (32 bits).
+ */
+void sonar_dispara(struct sonar_t *sonar, uint32_t tempo){
+    sonar->disparo = tempo;
+    sonar->estado = SONAR_ESPERA_SUBIDA;
+}
+
+/* Publica a medição terminada. Executado só na ISR (produtor único):
+ * geração ímpar enquanto os campos são escritos */
+static void sonar_publica(struct sonar_t *sonar, uint16_t bruta){
+
+    volatile struct sonar_amostra_t *amostra = &sonar->publicada;
+
+    sonar->geracao++;
+
+    amostra->largura = sonar->largura;
+    amostra->tempo = sonar->fim;
+    amostra->status = sonar->status;
+    amostra->bruta = bruta;
+    if (sonar_recente(sonar, sonar->fim))
+        amostra->mm = sonar->filtro.mediana;
+    else
+        amostra->mm = SONAR_MM_INVALIDO;
+
+    sonar->geracao++;
+}
+
+/* Medição perdida: descarta até o próximo trigger, no ritmo rápido */
+static void sonar_falha(struct sonar_t *sonar){
+    sonar->erros++;
+    sonar->status = SONAR_INVALIDA;
+    sonar->calmas = 0;
+    sonar->estado = SONAR_OCIOSO;
+    sonar_publica(sonar, SONAR_MM_INVALIDO);
+}
+
+/* Caminho livre e parado: amostra longe e perto da mediana anterior.
+ * Usa a amostra e não a mediana: um obstáculo que aparece volta ao
+ * ritmo rápido já na primeira medição, antes do filtro aceitá-lo */
+static void sonar_ritmo(struct sonar_t *sonar, uint16_t mm, uint16_t mediana){
+
+    uint16_t variacao = mm > mediana ? mm - mediana : mediana - mm;
+
+    if (mm >= SONAR_LIVRE_MM && mediana != SONAR_MM_INVALIDO &&
+            variacao <= SONAR_PARADO_MM){
+        if (sonar->calmas < SONAR_CALMAS)
+            sonar->calmas++;
+    }
+    else
+        sonar->calmas = 0;
+}
+
+/**
+ * @brief  Trata uma borda capturada do eco. Executado na ISR de captura.
+ *
+ *         O tipo da borda vem da sequência (após o trigger a primeira é
+ *         de subida, a segunda de descida), conferida pelos bits do
+ *         registrador de captura lidos na ISR, e não de uma nova leitura
+ *         do pino, que pode já ter mudado:
+ *         - COV: outra borda foi capturada antes desta ser lida, uma
+ *           borda foi perdida.
+ *         - CCI: nível da entrada. Deve ser o de depois da borda (1 após
+ *           a subida), a não ser que a borda seguinte já esteja
+ *           capturada (CCIFG de novo).
+ *
+ * @param  sonar: estado do sensor.
+ *         cctl: TBxCCTLn lido depois de TBxCCRn.
+ *         tempo: tempo da captura (32 bits).
+ *
+ * @retval 1 se a medição terminou (resultado em sonar->status).
+ */
+uint8_t sonar_captura(struct sonar_t *sonar, uint16_t cctl, uint32_t tempo){
+
+    uint8_t subida = (sonar->estado == SONAR_ESPERA_SUBIDA);
+    uint8_t nivel = (cctl & SONAR_CCTL_CCI) != 0;
+    uint16_t mm, mediana;
+
+    /* Sem trigger: resto de um eco já descartado */
+    if (sonar->estado == SONAR_OCIOSO)
+        return 0;
+
+    sonar->fim = tempo;
+
+    if (cctl & SONAR_CCTL_COV){
+        sonar_falha(sonar);
+        return 1;
+    }
+
+    if (nivel != subida && !(cctl & SONAR_CCTL_CCIFG)){
+        sonar_falha(sonar);
+        return 1;
+    }
+
+    if (subida){
+        sonar->subida = tempo;
+        sonar->estado = SONAR_ESPERA_DESCIDA;
+        return 0;
+    }
+
+    sonar->largura = tempo - sonar->subida;
+    sonar->status = sonar->largura >= SONAR_LARGURA_SEM_ALVO ? SONAR_SEM_ALVO : SONAR_VALIDA;
+    sonar->amostra = tempo;
+    sonar->estado = SONAR_OCIOSO;
+
+    mm = sonar_mm(sonar->largura);
+    mediana = sonar->filtro.mediana;
+    sonar_ritmo(sonar, mm, mediana);
+
+    /* Para a estimativa da aproximação só ecos medidos e aceitos */
+    if (sonar->status == SONAR_SEM_ALVO){
+        sonar_filtro_sem_alvo(&sonar->filtro, mm);
+        mm = SONAR_MM_INVALIDO;
+    }
+    else if (!sonar_filtro_insere(&sonar->filtro, mm))
+        mm = SONAR_MM_INVALIDO;
+    sonar_publica(sonar, mm);
+
+    return 1;
+}
+
+/**
+ * @brief  Encerra uma medição cujo eco não terminou: executado pelo
+ *         comparador do timer SONAR_TIMEOUT após o fim do pulso de
+ *         trigger.
+ *
+ * @param  sonar: estado do sensor.
+ *         tempo: tempo atual (32 bits).
+ *
+ * @retval 1 se havia uma medição em andamento.
+ */
+uint8_t sonar_timeout(struct sonar_t *sonar, uint32_t tempo){
+
+    if (sonar->estado == SONAR_OCIOSO)
+        return 0;
+
+    sonar->fim = tempo;
+    sonar->timeouts++;
+    sonar->status = SONAR_INVALIDA;
+    /* Ritmo rápido: sem saber o que está à frente, a próxima medição
+     * sai após SONAR_INTERVALO_MIN e não SONAR_INTERVALO_LENTO. Ecos
+     * perdidos seguidos deixam a distância velha em SONAR_VALIDADE */
+    sonar->calmas = 0;
+    sonar->estado = SONAR_OCIOSO;
+    sonar_publica(sonar, SONAR_MM_INVALIDO);
+
+    return 1;
+}
+
+/**
+ * @brief  Verifica se a distância filtrada pode ser usada: a última
+ *         medição com eco tem menos de SONAR_VALIDADE.
+ *
+ * @param  sonar: estado do sensor.
+ *         agora: tempo atual (32 bits).
+ *
+ * @retval 1 se recente, 0 se velha ou sem nenhuma amostra.
+ */
+uint8_t sonar_recente(const struct sonar_t *sonar, uint32_t agora){
+
+    if (sonar->filtro.mediana == SONAR_MM_INVALIDO)
+        return 0;
+
+    return (agora - sonar->amostra) < SONAR_VALIDADE;
+}
+
+/**
+ * @brief  Lê a última medição publicada sem desabilitar interrupções.
+ *
+ *         Consumidor do seqlock: se a ISR publicou durante a cópia
+ *         (geração mudou ou ímpar) a cópia é refeita. No MSP430 a ISR
+ *         termina antes do main continuar: no máximo uma repetição.
+ *
+ * @param  sonar: estado do sensor.
+ *         amostra: destino da cópia.
+ *
+ * @retval geração da amostra copiada: muda a cada medição terminada.
+ */
+uint16_t sonar_le(const struct sonar_t *sonar, struct sonar_amostra_t *amostra){
+
+    uint16_t geracao;
+
+    do {
+        geracao = sonar->geracao;
+
+        amostra->largura = sonar->publicada.largura;
+        amostra->tempo = sonar->publicada.tempo;
+        amostra->mm = sonar->publicada.mm;
+        amostra->bruta = sonar->publicada.bruta;
+        amostra->status = sonar->publicada.status;
+    } while ((geracao & 1) || geracao != sonar->geracao);
+
+    return geracao;
+}
+
+/**
+ * @brief  Tempo do próximo disparo após o fim de uma medição.
+ *
+ *         Assim que o eco termina, respeitando o intervalo mínimo desde
+ *         o disparo anterior. Com o caminho livre e parado o intervalo
+ *         é o lento: poucas medições quando não há nada por perto.
+ *
+ * @param  sonar: estado do sensor, medição terminada.
+ *
+ * @retval tempo do próximo disparo (32 bits, mesma base de sonar_captura).
+ */
+uint32_t sonar_proximo(const struct sonar_t *sonar){
+
+    uint32_t proximo = sonar->disparo;
+
+    if (sonar->calmas >= SONAR_CALMAS)
+        proximo += SONAR_INTERVALO_LENTO;
+    else
+        proximo += SONAR_INTERVALO_MIN;
+
+    /* Eco mais longo que o intervalo: dispara logo após o fim */
+    if ((int32_t)(sonar->fim - proximo) > 0)
+        proximo = sonar->fim;
+
+    return proximo;
+}
+
+/**
+ * @brief  Agenda o próximo disparo. Em seguida a ISR0 deve ser chamada
+ *         (CCR0 logo adiante de TBxR) para programar o pulso ou a espera.
+ *
+ * @param  agenda: agendamento do comparador 0.
+ *         quando: tempo do disparo (32 bits), no passado: o quanto antes.
+ *
+ * @retval 0 durante um pulso: o agendamento é feito no fim dele.
+ */
+uint8_t sonar_agenda(struct sonar_agenda_t *agenda, uint32_t quando){
+
+    if (agenda->fase == SONAR_FASE_PULSO)
+        return 0;
+
+    agenda->proximo = quando;
+    agenda->fase = SONAR_FASE_ESPERA;
+
+    return 1;
+}
+
+/**
+ * @brief  Decisão da ISR0 (comparação com TBxCCR0) do sensor ativo.
+ *
+ *         SONAR_FASE_PULSO: fim do pulso de trigger (a ISR já desligou a
+ *         saída). Passa a contar o timeout do eco a partir daqui.
+ *
+ *         SONAR_FASE_ECO: ainda no prazo, CCR0 alcança os 16 bits de
+ *         baixo do timeout a cada volta. Depois do prazo o eco não
+ *         terminou: SONAR_CCR0_TIMEOUT. O fim do eco na ISR de captura
+ *         agenda o próximo disparo antes disso.
+ *
+ *         SONAR_FASE_ESPERA: com o disparo a menos de meia volta o pulso
+ *         é programado no tempo exato (CCR1 = proximo). Mais longe, CCR0
+ *         acorda de novo a uma volta da posição de meia volta antes do
+ *         disparo. Atrasado: dispara o quanto antes.
+ *
+ * @param  agenda: agendamento do comparador 0.
+ *         agora: tempo atual (32 bits).
+ *         ccr0: destino do novo TBxCCR0 (SONAR_CCR0_ESPERA e
+ *         SONAR_CCR0_PULSO).
+ *
+ * @retval SONAR_CCR0_ESPERA, SONAR_CCR0_PULSO (pulso em agenda->proximo)
+ *         ou SONAR_CCR0_TIMEOUT.
+ */
+uint8_t sonar_comparador(struct sonar_agenda_t *agenda, uint32_t agora, uint16_t *ccr0){
+
+    uint32_t resto;
+
+    if (agenda->fase == SONAR_FASE_PULSO){
+        agenda->fase = SONAR_FASE_ECO;
+        /* proximo: início do pulso. Timeout contado do fim do pulso */
+        agenda->proximo += SONAR_TRIGGER_LARGURA + SONAR_TIMEOUT;
+    }
+
+    resto = agenda->proximo - agora;
+
+    if (agenda->fase == SONAR_FASE_ECO){
+        if ((int32_t)resto > SONAR_TRIGGER_ATRASO){
+            *ccr0 = (uint16_t)agenda->proximo;
+            return SONAR_CCR0_ESPERA;
+        }
+
+        agenda->fase = SONAR_FASE_ESPERA;
+        return SONAR_CCR0_TIMEOUT;
+    }
+
+    if ((int32_t)resto < SONAR_TRIGGER_ATRASO){
+        agenda->proximo = agora + SONAR_TRIGGER_ATRASO;
+        resto = SONAR_TRIGGER_ATRASO;
+    }
+
+    if (resto < 0x8000){
+        *ccr0 = (uint16_t)agenda->proximo + SONAR_TRIGGER_LARGURA;
+        agenda->fase = SONAR_FASE_PULSO;
+        return SONAR_CCR0_PULSO;
+    }
+
+    *ccr0 = (uint16_t)(agenda->proximo - 0x4000);
+    return SONAR_CCR0_ESPERA;
+}
+
+void sonar_filtro_init(struct sonar_filtro_t *filtro){
+    filtro->proxima = 0;
+    filtro->quantidade = 0;
+    filtro->rejeitadas = 0;
+    filtro->candidata = 0;
+    filtro->mediana = SONAR_MM_INVALIDO;
+    filtro->outliers = 0;
+}
+
+/* Amostra fora da janela: conta a sequência de amostras seguidas no
+ * mesmo nível (até SONAR_PASSO_MAX da anterior). Outro nível começa uma
+ * nova sequência. Retorna 1 quando a sequência passa de
+ * SONAR_REJEICOES_MAX: o novo nível é real */
+static uint8_t sonar_filtro_fora(struct sonar_filtro_t *filtro, uint16_t mm){
+
+    uint16_t dif = mm > filtro->candidata ? mm - filtro->candidata : filtro->candidata - mm;
+    uint8_t mesmo_nivel = filtro->rejeitadas && dif <= SONAR_PASSO_MAX;
+
+    if (mesmo_nivel && filtro->rejeitadas >= SONAR_REJEICOES_MAX)
+        return 1;
+
+    filtro->rejeitadas = mesmo_nivel ? filtro->rejeitadas + 1 : 1;
+    filtro->candidata = mm;
+
+    return 0;
+}
+
+/**
+ * @brief  Insere uma amostra no filtro de mediana.
+ *
+ *         O vetor ordenado é mantido a cada amostra: a mais antiga é
+ *         retirada e a nova entra no seu lugar, deslocando só os
+ *         elementos entre as duas posições (O(N), sem ordenar de novo).
+ *         A mediana fica pronta em filtro->mediana.
+ *
+ * @param  filtro: estado do filtro.
+ *         mm: distância medida.
+ *
+ * @retval 1 se a amostra foi aceita, 0 se foi descartada como outlier.
+ */
+uint8_t sonar_filtro_insere(struct sonar_filtro_t *filtro, uint16_t mm){
+
+    uint16_t *ord = filtro->ordenadas;
+    uint16_t antiga;
+    uint8_t i;
+
+    /* Porta de outliers: salto grande em relação à mediana. Novo nível
+     * confirmado: a janela recomeça com a amostra, sem esperar ela ser
+     * a maioria da janela antiga */
+    if (filtro->quantidade){
+        uint16_t passo = mm > filtro->mediana ? mm - filtro->mediana : filtro->mediana - mm;
+
+        if (passo > SONAR_PASSO_MAX){
+            if (!sonar_filtro_fora(filtro, mm)){
+                filtro->outliers++;
+                return 0;
+            }
+            filtro->quantidade = 0;
+            filtro->proxima = 0;
+        }
+    }
+    filtro->rejeitadas = 0;
+
+    if (filtro->quantidade < SONAR_FILTRO_N){
+        /* Enchendo: inserção no fim da parte ordenada */
+        i = filtro->quantidade++;
+        while (i > 0 && ord[i - 1] > mm){
+            ord[i] = ord[i - 1];
+            i--;
+        }
+    }
+    else {
+        /* Cheio: a nova amostra ocupa o lugar da mais antiga */
+        antiga = filtro->amostras[filtro->proxima];
+        for (i = 0; ord[i] != antiga; i++)
+            ;
+
+        while (i + 1 < SONAR_FILTRO_N && ord[i + 1] < mm){
+            ord[i] = ord[i + 1];
+            i++;
+        }
+        while (i > 0 && ord[i - 1] > mm){
+            ord[i] = ord[i - 1];
+            i--;
+        }
+    }
+    ord[i] = mm;
+
+    filtro->amostras[filtro->proxima] = mm;
+    if (++filtro->proxima == SONAR_FILTRO_N)
+        filtro->proxima = 0;
+
+    filtro->mediana = ord[filtro->quantidade / 2];
+
+    return 1;
+}
+
+/**
+ * @brief  Eco sem alvo: não entra na janela (a distância do eco máximo
+ *         não é de um obstáculo). Repetido mais de SONAR_REJEICOES_MAX
+ *         vezes seguidas, o que estava à frente saiu do alcance: a janela
+ *         é esvaziada e a mediana passa a ser a distância livre. O eco
+ *         seguinte entra sem passar pela porta de outliers.
+ *
+ * @param  filtro: estado do filtro.
+ *         mm: distância do eco sem alvo.
+ *
+ * @retval none
+ */
+void sonar_filtro_sem_alvo(struct sonar_filtro_t *filtro, uint16_t mm){
+
+    if (filtro->quantidade && !sonar_filtro_fora(filtro, mm))
+        return;
+
+    filtro->quantidade = 0;
+    filtro->proxima = 0;
+    filtro->rejeitadas = 0;
+    filtro->mediana = mm;
+}
+
+void sonar_aprox_init(struct sonar_aprox_t *aprox){
+    aprox->proxima = 0;
+    aprox->quantidade = 0;
+    aprox->referencia = 0;
+    aprox->st = aprox->stt = aprox->sd = aprox->std = 0;
+    aprox->velocidade = 0;
+    aprox->ttc = SONAR_TTC_INFINITO;
+}
+
+/* Soma (sinal 1) ou retira (sinal -1) uma amostra das somas */
+static void sonar_aprox_soma(struct sonar_aprox_t *aprox, uint32_t tempo, uint16_t mm, int8_t sinal){
+
+    int32_t t = (int32_t)(tempo - aprox->referencia) * sinal;
+    int32_t d = (int32_t)mm * sinal;
+
+    aprox->st += t;
+    aprox->stt += t * (int32_t)(tempo - aprox->referencia);
+    aprox->sd += d;
+    aprox->std += t * (int32_t)mm;
+}
+
+/**
+ * @brief  Insere uma amostra e atualiza a velocidade de aproximação e o
+ *         tempo até a colisão. O(1): a amostra mais antiga sai das somas
+ *         e a nova entra, sem percorrer a janela.
+ *
+ *         Reta d = a + b.t por mínimos quadrados:
+ *
+ *             b = (n.Std - St.Sd) / (n.Stt - St²)
+ *
+ *         velocidade = -b (mm/s, positiva aproximando) e
+ *         ttc = distância / velocidade.
+ *
+ *         Os tempos são relativos à referência. Quando a nova amostra
+ *         se afasta mais de SONAR_APROX_RECENTRA dela, a referência vai
+ *         para a amostra mais antiga e as somas são corrigidas sem
+ *         percorrer as amostras (deslocamento D):
+ *
+ *             Stt' = Stt - 2.D.St + n.D²   Std' = Std - D.Sd
+ *             St'  = St - n.D
+ *
+ *         Assim os termos ficam abaixo de 2^31 (janela de até ~3,5s).
+ *
+ *         Custo no MSP430: a velocidade usa uma divisão 64/32 (rotina
+ *         da biblioteca do compilador, sem divisor em hardware), da
+ *         ordem de 2000 a 3000 ciclos (~0,1ms a 24MHz), mais uma 32/32
+ *         do ttc. Chamar só com amostra nova, fora da ISR.
+ *
+ * @param  aprox: estado do estimador.
+ *         tempo: tempo da medição (32 bits, contagens do timer).
+ *         mm: distância da medição.
+ *
+ * @retval none
+ */
+void sonar_aprox_insere(struct sonar_aprox_t *aprox, uint32_t tempo, uint16_t mm){
+
+    uint32_t unidades = tempo >> SONAR_APROX_SHIFT;
+    uint8_t ultima, antiga;
+    int32_t n, num, den, desloc, velocidade, ttc;
+
+    /* Amostras velhas não descrevem o movimento atual */
+    if (aprox->quantidade){
+        ultima = (aprox->proxima ? aprox->proxima : SONAR_APROX_N) - 1;
+        if (unidades - aprox->tempos[ultima] > (SONAR_APROX_LACUNA >> SONAR_APROX_SHIFT))
+            sonar_aprox_init(aprox);
+    }
+
+    /* Janela cheia: sai a mais antiga, que será sobrescrita */
+    if (aprox->quantidade == SONAR_APROX_N){
+        sonar_aprox_soma(aprox, aprox->tempos[aprox->proxima],
+                         aprox->distancias[aprox->proxima], -1);
+        aprox->quantidade--;
+    }
+
+    n = aprox->quantidade;
+    if (!n)
+        aprox->referencia = unidades;
+    else if (unidades - aprox->referencia > SONAR_APROX_RECENTRA){
+        antiga = (aprox->proxima + SONAR_APROX_N - n) % SONAR_APROX_N;
+        desloc = aprox->tempos[antiga] - aprox->referencia;
+
+        aprox->stt += n * desloc * desloc - 2 * desloc * aprox->st;
+        aprox->std -= desloc * aprox->sd;
+        aprox->st -= n * desloc;
+        aprox->referencia += desloc;
+    }
+
+    aprox->tempos[aprox->proxima] = unidades;
+    aprox->distancias[aprox->proxima] = mm;
+    if (++aprox->proxima == SONAR_APROX_N)
+        aprox->proxima = 0;
+    n = ++aprox->quantidade;
+    sonar_aprox_soma(aprox, unidades, mm, 1);
+
+    aprox->velocidade = 0;
+    aprox->ttc = SONAR_TTC_INFINITO;
+
+    num = n * aprox->std - aprox->st * aprox->sd;
+    den = n * aprox->stt - aprox->st * aprox->st;
+    if (n < SONAR_APROX_MIN || den <= 0)
+        return;
+
+    /* mm por unidade de tempo para mm/s */
+    velocidade = -(int32_t)(((int64_t)num * (int32_t)SONAR_APROX_FREQ) / den);
+    if (velocidade > INT16_MAX)
+        velocidade = INT16_MAX;
+    else if (velocidade < INT16_MIN)
+        velocidade = INT16_MIN;
+    aprox->velocidade = velocidade;
+
+    if (velocidade < SONAR_VELOCIDADE_MIN)
+        return;
+
+    ttc = ((int32_t)mm * 1000) / velocidade;
+    aprox->ttc = ttc < SONAR_TTC_INFINITO ? ttc : SONAR_TTC_INFINITO - 1;
+}
+
+/**
+ * @brief  Ajusta a velocidade do som para a temperatura ambiente.
+ *         Só multiplicação: pode ser chamada a cada leitura do sensor
+ *         de temperatura.
+ *
+ * @param  decimos: temperatura em décimos de °C (ex.: 235 = 23,5 °C).
+ *
+ * @retval none
+ */
+void sonar_temperatura(int16_t decimos){
+    escala = (uint32_t)((int32_t)SONAR_K0 + (int32_t)decimos * (int32_t)SONAR_K1) >> 8;
+}
+
+/**
+ * @brief  Converte a largura do eco para milímetros.
+ *         Executado a cada eco: uma multiplicação 32x16 e um
+ *         deslocamento, sem divisão.
+ *
+ * @param  largura: largura do eco em contagens do timer.
+ *
+ * @retval distância em mm.
+ */
+uint16_t sonar_mm(uint32_t largura){
+
+    if (largura > SONAR_LARGURA_MAX)
+        largura = SONAR_LARGURA_MAX;
+
+    return (largura * escala) >> 16;
+}
+
+/* Posição de um sensor no rodízio: pares e depois ímpares */
+static uint8_t sonar_posicao(uint8_t sensor, uint8_t n){
+    return (sensor & 1) ? (n + 1) / 2 + sensor / 2 : sensor / 2;
+}
+
+/* Sensor de uma posição do rodízio */
+static uint8_t sonar_ordem(uint8_t posicao, uint8_t n){
+
+    uint8_t pares = (n + 1) / 2;
+
+    return posicao < pares ? 2 * posicao : 2 * (posicao - pares) + 1;
+}
+
+/**
+ * @brief  Escolhe o próximo sensor a disparar após o fim da medição do
+ *         sensor atual.
+ *
+ *         Nenhum sensor dispara antes do fim do eco do atual e de
+ *         SONAR_GUARDA após o seu disparo. Entre os sensores, o que pode
+ *         disparar mais cedo (sonar_proximo: intervalo mínimo ou lento de
+ *         cada um); empate, o seguinte na ordem do rodízio. Sensores com
+ *         o caminho livre cedem a vez aos que têm obstáculo perto.
+ *
+ * @param  sensores: estados dos sensores.
+ *         n: quantidade de sensores.
+ *         atual: sensor cuja medição terminou.
+ *         quando: tempo do próximo disparo (32 bits).
+ *
+ * @retval sensor a disparar.
+ */
+uint8_t sonar_rodizio(const struct sonar_t sensores[], uint8_t n, uint8_t atual, uint32_t *quando){
+
+    const struct sonar_t *anterior = &sensores[atual];
+    uint32_t livre = anterior->disparo + SONAR_GUARDA;
+    uint32_t tempo, melhor = 0;
+    uint8_t posicao = sonar_posicao(atual, n);
+    uint8_t i, sensor, escolhido = atual;
+
+    /* Um eco de cada vez */
+    if ((int32_t)(anterior->fim - livre) > 0)
+        livre = anterior->fim;
+
+    for (i = 0; i < n; i++){
+        if (++posicao == n)
+            posicao = 0;
+
+        sensor = sonar_ordem(posicao, n);
+        tempo = sonar_proximo(&sensores[sensor]);
+        if ((int32_t)(tempo - livre) < 0)
+            tempo = livre;
+
+        if (i == 0 || (int32_t)(tempo - melhor) < 0){
+            escolhido = sensor;
+            melhor = tempo;
+        }
+    }
+
+    *quando = melhor;
+
+    return escolhido;
+}
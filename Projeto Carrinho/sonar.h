@@ -0,0 +1,265 @@
+/*
+ *  Modulo: sonar.h
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Processamento das medições do sensor HC-SR04.
+ *  Código portável (sem registradores): hc_sr04.c lê o Timer B1 nas
+ *  ISRs e entrega os tempos de captura para as funções deste módulo.
+ *  O mesmo código roda no host para testes (veja sonar.c).
+ */
+
+#ifndef SONAR_H_
+#define SONAR_H_
+
+#include <stdint.h>
+
+/* Frequência do Timer B1: SMCLK / SONAR_DIVISOR (1, 2, 4 ou 8).
+ * O tempo é estendido para 32 bits: com divisor 1 o eco de 4m
+ * (~23ms, 560000 contagens) também é medido sem erro de volta. */
+#define SONAR_SMCLK_FREQ (24000000UL)
+#define SONAR_DIVISOR    (8)
+#define SONAR_TIMER_FREQ (SONAR_SMCLK_FREQ / SONAR_DIVISOR)
+
+/* Conversão de contagens para milímetros: mm = (largura * escala) >> 16
+ *
+ *  Velocidade do som: c = 331,3 + 0,606 * T  (m/s, T em °C)
+ *  distância = largura * (c / 2) / SONAR_TIMER_FREQ
+ *
+ *  escala = c(mm/s) * 2^15 / SONAR_TIMER_FREQ, calculada a partir de
+ *  constantes em Q24 (SONAR_K0, SONAR_K1) para não precisar de divisão
+ *  no MSP430. Com 3MHz: escala ~3618 a 0 °C e ~3750 a 20 °C. */
+#define SONAR_K0 ((uint32_t)((331300ULL << 23) / SONAR_TIMER_FREQ))      /* 0 °C */
+#define SONAR_K1 ((uint32_t)((606ULL << 23) / (10 * SONAR_TIMER_FREQ)))  /* por 0,1 °C */
+
+/* Temperatura inicial em décimos de °C */
+#define SONAR_TEMPERATURA (200)
+
+/* Larguras maiores são limitadas (sem eco o HC-SR04 dá ~38ms): mantém
+ * o produto em 32 bits e o resultado em 16 bits */
+#define SONAR_LARGURA_MAX ((SONAR_TIMER_FREQ / 1000) * 60)
+
+/* Eco a partir desta largura: nenhum alvo no alcance (> 5m) */
+#define SONAR_LARGURA_SEM_ALVO ((SONAR_TIMER_FREQ / 1000) * 30)
+
+/* Pulso de trigger: largura (10us) e atraso mínimo entre a programação
+ * e o início do pulso, em contagens do timer. O atraso cobre a ISR0
+ * entre a leitura de TBxR e OUTMOD_3 (tempo_captura, sonar_comparador
+ * com o cálculo de 32 bits e as escritas): SONAR_TRIGGER_CICLOS ciclos
+ * da CPU (MCLK = SMCLK), as mesmas ~11us com qualquer divisor */
+#define SONAR_TRIGGER_LARGURA ((SONAR_TIMER_FREQ / 1000000) * 10)
+#define SONAR_TRIGGER_CICLOS  (256)
+#define SONAR_TRIGGER_ATRASO  (SONAR_TRIGGER_CICLOS / SONAR_DIVISOR)
+
+/* Tempo máximo do fim do pulso de trigger até o fim do eco: depois
+ * disso a medição é encerrada (sensor não respondeu ou borda de descida
+ * perdida). Cobre o atraso do sensor e o eco sem alvo (~38ms) */
+#define SONAR_TIMEOUT ((SONAR_TIMER_FREQ / 1000) * 50)
+
+/* Idade máxima da última amostra aceita para a distância ser usada:
+ * maior que SONAR_INTERVALO_LENTO */
+#define SONAR_VALIDADE ((SONAR_TIMER_FREQ / 1000) * 400)
+
+/* Filtro das distâncias (mm): mediana das últimas SONAR_FILTRO_N
+ * amostras. Uma amostra que se afasta mais de SONAR_PASSO_MAX da
+ * mediana é descartada. Mais de SONAR_REJEICOES_MAX descartadas seguidas
+ * no mesmo nível (obstáculo que realmente apareceu) recomeçam a janela
+ * nesse nível: a mediana acompanha já nessa amostra. Ecos sem alvo não
+ * entram na janela: repetidos, esvaziam o filtro (caminho livre). */
+#define SONAR_FILTRO_N       (5)
+#define SONAR_PASSO_MAX      (300)
+#define SONAR_REJEICOES_MAX  (2)
+
+/* Ritmo das medições: o próximo trigger sai assim que o eco termina,
+ * mas nunca antes de SONAR_INTERVALO_MIN do trigger anterior (ecos do
+ * disparo anterior em paredes distantes ainda chegando). Com o caminho
+ * livre (mediana >= SONAR_LIVRE_MM) e parado (variação até
+ * SONAR_PARADO_MM) por SONAR_CALMAS medições seguidas o intervalo passa
+ * a ser SONAR_INTERVALO_LENTO. Intervalos em contagens do timer. */
+#define SONAR_INTERVALO_MIN   ((SONAR_TIMER_FREQ / 1000) * 25)
+#define SONAR_INTERVALO_LENTO ((SONAR_TIMER_FREQ / 1000) * 250)
+#define SONAR_LIVRE_MM        (1500)
+#define SONAR_PARADO_MM       (30)
+#define SONAR_CALMAS          (8)
+
+/* Vários sensores (veja hc_sr04.c) são disparados um de cada vez, em
+ * rodízio (sonar_rodizio). Índices pela posição no carrinho (vizinhos
+ * com índices seguidos): pares primeiro e depois ímpares, sensores
+ * vizinhos não disparam em seguida. Entre dois disparos, o fim do eco
+ * anterior e SONAR_GUARDA: ecos do disparo de um sensor em paredes
+ * distantes não são lidos pelo seguinte. */
+#define SONAR_GUARDA ((SONAR_TIMER_FREQ / 1000) * 15)
+
+/* Velocidade de aproximação e tempo até a colisão: reta de mínimos
+ * quadrados sobre as últimas SONAR_APROX_N amostras aceitas pelo filtro.
+ * Tempo em unidades de 2^SONAR_APROX_SHIFT contagens (~1,4ms a 3MHz).
+ * Um intervalo maior que SONAR_APROX_LACUNA entre amostras recomeça a
+ * janela. Abaixo de SONAR_VELOCIDADE_MIN (mm/s) não há aproximação. */
+#define SONAR_APROX_N          (8)
+#define SONAR_APROX_MIN        (3)
+#define SONAR_APROX_SHIFT      (12)
+#define SONAR_APROX_FREQ       (SONAR_TIMER_FREQ >> SONAR_APROX_SHIFT)
+#define SONAR_APROX_LACUNA     ((SONAR_TIMER_FREQ / 1000) * 500)
+#define SONAR_APROX_RECENTRA   (1024)
+#define SONAR_VELOCIDADE_MIN   (20)
+
+/* Tempo até a colisão sem aproximação */
+#define SONAR_TTC_INFINITO     (0xffff)
+
+/* Distância sem valor (filtro vazio) */
+#define SONAR_MM_INVALIDO    (0xffff)
+
+/* Bits de TBxCCTLn usados na classificação das bordas: mesmos valores
+ * do msp430.h, para o código portável não depender dele */
+#define SONAR_CCTL_CCIFG (0x0001)  /* Nova captura pendente */
+#define SONAR_CCTL_COV   (0x0002)  /* Captura sobrescrita sem ser lida */
+#define SONAR_CCTL_CCI   (0x0008)  /* Nível atual da entrada */
+
+/* Estados da medição */
+#define SONAR_OCIOSO          (0)  /* Sem trigger em andamento */
+#define SONAR_ESPERA_SUBIDA   (1)  /* Trigger enviado, esperando o eco */
+#define SONAR_ESPERA_DESCIDA  (2)  /* Eco em andamento */
+
+/* Resultado da última medição */
+#define SONAR_NENHUMA   (0)  /* Nenhuma medição terminada */
+#define SONAR_VALIDA    (1)  /* Eco medido */
+#define SONAR_SEM_ALVO  (2)  /* Eco máximo: nada no alcance */
+#define SONAR_INVALIDA  (3)  /* Borda perdida ou timeout */
+
+/* Fases do agendamento no comparador 0 do timer (sonar_comparador) */
+#define SONAR_FASE_ESPERA     (0)  /* Contando até o próximo disparo */
+#define SONAR_FASE_PULSO      (1)  /* Pulso de trigger, CCR0 = fim do pulso */
+#define SONAR_FASE_ECO        (2)  /* Esperando o eco, contando até o timeout */
+
+/* O que a ISR do comparador 0 faz (retorno de sonar_comparador) */
+#define SONAR_CCR0_ESPERA     (0)  /* Só reprograma CCR0 */
+#define SONAR_CCR0_PULSO      (1)  /* Pulso: CCR1 = proximo, CCR0, OUTMOD_3 */
+#define SONAR_CCR0_TIMEOUT    (2)  /* Eco não terminou: sonar_timeout */
+
+/* Resultado publicado ao fim de cada medição (veja sonar_le) */
+struct sonar_amostra_t {
+    /* Largura do último eco em contagens do timer */
+    uint32_t largura;
+    /* Fim da medição (32 bits) */
+    uint32_t tempo;
+    /* Distância filtrada em mm, SONAR_MM_INVALIDO se velha */
+    uint16_t mm;
+    /* Distância desta medição em mm, SONAR_MM_INVALIDO se não foi
+     * aceita pelo filtro (falha, sem alvo ou outlier) */
+    uint16_t bruta;
+    /* SONAR_VALIDA, SONAR_SEM_ALVO ou SONAR_INVALIDA */
+    uint8_t status;
+};
+
+/* Filtro de mediana com rejeição de outliers */
+struct sonar_filtro_t {
+    /* Amostras em ordem de chegada (anel) e as mesmas ordenadas */
+    uint16_t amostras[SONAR_FILTRO_N];
+    uint16_t ordenadas[SONAR_FILTRO_N];
+    /* Posição do anel com a amostra mais antiga */
+    uint8_t proxima;
+    uint8_t quantidade;
+    /* Amostras seguidas fora da janela e o nível da última */
+    uint8_t rejeitadas;
+    uint16_t candidata;
+
+    /* Resultado: lido pelo main em O(1) */
+    volatile uint16_t mediana;
+    volatile uint16_t outliers;
+};
+
+/* Estimador da aproximação: somas da reta de mínimos quadrados mantidas
+ * a cada amostra (entra a nova, sai a mais antiga), tempos relativos a
+ * uma referência para as somas caberem em 32 bits */
+struct sonar_aprox_t {
+    /* Amostras em anel: tempo (unidades) e distância (mm) */
+    uint32_t tempos[SONAR_APROX_N];
+    uint16_t distancias[SONAR_APROX_N];
+    uint8_t proxima;
+    uint8_t quantidade;
+
+    /* Referência dos tempos e somas: t, t², d, t.d */
+    uint32_t referencia;
+    int32_t st, stt, sd, std;
+
+    /* Resultado: mm/s (positiva aproximando) e ms até a colisão */
+    int16_t velocidade;
+    uint16_t ttc;
+};
+
+/* Agendamento do comparador 0 do timer do sensor ativo: alterado
+ * somente com interrupções desabilitadas */
+struct sonar_agenda_t {
+    uint8_t fase;
+    /* Tempo do próximo disparo ou, em SONAR_FASE_ECO, do timeout */
+    uint32_t proximo;
+};
+
+/* Estado de um sensor: alterado somente pelas ISRs */
+struct sonar_t {
+    volatile uint8_t estado;
+    /* Tempos do início do trigger, da borda de subida do eco e do fim
+     * da medição */
+    uint32_t disparo;
+    uint32_t subida;
+    uint32_t fim;
+
+    /* Medições seguidas com caminho livre e parado */
+    uint8_t calmas;
+
+    /* Última medição: largura do eco em contagens do timer e resultado
+     * (SONAR_VALIDA, ...). Tempo da última medição com eco (válida ou
+     * sem alvo): idade da distância filtrada */
+    volatile uint32_t largura;
+    volatile uint8_t status;
+    volatile uint32_t amostra;
+
+    /* Bordas perdidas e ecos que não terminaram: medição descartada */
+    volatile uint16_t erros;
+    volatile uint16_t timeouts;
+
+    /* Distâncias das medições válidas, filtradas */
+    struct sonar_filtro_t filtro;
+
+    /* Resultado para o main: escrito só pela ISR, protegido pelo
+     * contador de geração (ímpar durante a escrita) */
+    volatile struct sonar_amostra_t publicada;
+    volatile uint16_t geracao;
+};
+
+/* Tempo de 32 bits de uma captura: voltas contadas pela ISR de TBIFG e
+ * TBIFG ainda pendente. Executado na ISR de captura, que tem prioridade
+ * sobre TBIFG: se a volta ainda não foi contada e a captura é do início
+ * da contagem, ela é da volta seguinte. Com TBxR é o tempo atual
+ * (interrupções desabilitadas) */
+static inline uint32_t sonar_tempo(uint16_t voltas, uint8_t tbifg, uint16_t ccr){
+
+    if (tbifg && ccr < 0x8000)
+        voltas++;
+
+    return ((uint32_t)voltas << 16) | ccr;
+}
+
+void sonar_init(struct sonar_t *sonar);
+void sonar_dispara(struct sonar_t *sonar, uint32_t tempo);
+uint8_t sonar_captura(struct sonar_t *sonar, uint16_t cctl, uint32_t tempo);
+uint8_t sonar_timeout(struct sonar_t *sonar, uint32_t tempo);
+uint32_t sonar_proximo(const struct sonar_t *sonar);
+uint8_t sonar_rodizio(const struct sonar_t sensores[], uint8_t n, uint8_t atual, uint32_t *quando);
+uint8_t sonar_recente(const struct sonar_t *sonar, uint32_t agora);
+uint16_t sonar_le(const struct sonar_t *sonar, struct sonar_amostra_t *amostra);
+
+uint8_t sonar_agenda(struct sonar_agenda_t *agenda, uint32_t quando);
+uint8_t sonar_comparador(struct sonar_agenda_t *agenda, uint32_t agora, uint16_t *ccr0);
+
+void sonar_filtro_init(struct sonar_filtro_t *filtro);
+uint8_t sonar_filtro_insere(struct sonar_filtro_t *filtro, uint16_t mm);
+void sonar_filtro_sem_alvo(struct sonar_filtro_t *filtro, uint16_t mm);
+
+void sonar_aprox_init(struct sonar_aprox_t *aprox);
+void sonar_aprox_insere(struct sonar_aprox_t *aprox, uint32_t tempo, uint16_t mm);
+
+void sonar_temperatura(int16_t decimos);
+uint16_t sonar_mm(uint32_t largura);
+
+#endif /* SONAR_H_ */
@@ -0,0 +1,96 @@
+/*
+ *  Modulo: telemetria.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Telemetria periódica do carrinho.
+ *
+ *  - A cada período (ticks do watchdog) os valores são lidos de uma vez
+ *    e colocados em um único quadro de tamanho fixo:
+ *
+ *      +-------+-----------+-------+-------+---------+------------+
+ *      | tempo | distância | bat 1 | bat 2 | direção | velocidade |
+ *      |  u16  |    u16    |  u16  |  u16  |   u8    |    u16     |
+ *      +-------+-----------+-------+-------+---------+------------+
+ *
+ *  - Um quadro só ao invés de uma mensagem por valor: o host recebe
+ *    valores do mesmo instante e a UART faz uma transferência só.
+ *  - Baterias em décimos de volt (medicao_bateria_*), distância em
+ *    mm (0xffff: sem medição recente) e direção conforme motor.h.
+ *    A distância filtrada já é de 16 bits (alcance de ~4m).
+ *  - Após montar o quadro a próxima conversão das baterias é iniciada:
+ *    o valor enviado é sempre o da conversão do tick anterior.
+ */
+
+#include <msp430.h>
+#include <stdint.h>
+
+#include "telemetria.h"
+#include "protocolo.h"
+#include "baterias.h"
+#include "hc_sr04.h"
+#include "motor.h"
+
+/* Período em ticks do watchdog: 0 desliga */
+static uint16_t periodo_ticks = TELEMETRIA_PERIODO;
+static uint16_t ultimo_tick = 0;
+
+/**
+ * @brief  Altera o período da telemetria.
+ *
+ * @param  periodo: ticks do watchdog (~16ms) entre mensagens, 0 desliga.
+ *
+ * @retval none
+ */
+void telemetria_periodo(uint16_t periodo){
+    periodo_ticks = periodo;
+    ultimo_tick = wdt_ticks;
+}
+
+/**
+ * @brief  Verifica se o período terminou. Chamar a cada volta do main.
+ *
+ * @retval 1 se uma mensagem deve ser enviada agora.
+ */
+uint8_t telemetria_tick(){
+
+    uint16_t agora = wdt_ticks;
+
+    if (!periodo_ticks || (uint16_t)(agora - ultimo_tick) < periodo_ticks)
+        return 0;
+
+    ultimo_tick = agora;
+    return 1;
+}
+
+/**
+ * @brief  Monta os dados de PROTO_ID_TELEMETRIA.
+ *
+ * @param  payload: destino com pelo menos TELEMETRIA_SIZE bytes.
+ *         distancia: última medição do sensor em mm.
+ *
+ * @retval tamanho dos dados.
+ */
+uint8_t telemetria_monta(uint8_t *payload, uint16_t distancia){
+
+    uint16_t state = __get_interrupt_state();
+    uint16_t tempo, bateria_1, bateria_2;
+
+    /* Baterias são escritas pela ISR do ADC: as duas do mesmo instante */
+    __disable_interrupt();
+    tempo = wdt_ticks;
+    bateria_1 = medicao_bateria_1();
+    bateria_2 = medicao_bateria_2();
+    __set_interrupt_state(state);
+
+    proto_set_u16(payload, tempo);
+    proto_set_u16(payload + 2, distancia);
+    proto_set_u16(payload + 4, bateria_1);
+    proto_set_u16(payload + 6, bateria_2);
+    payload[8] = estado_carrinho.direcao;
+    proto_set_u16(payload + 9, estado_carrinho.velocidade);
+
+    inicia_medicao_baterias();
+
+    return TELEMETRIA_SIZE;
+}
@@ -0,0 +1,26 @@
+/*
+ *  Modulo: telemetria.h
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Telemetria periódica do carrinho: uma mensagem
+ *  PROTO_ID_TELEMETRIA com distância, baterias e estado dos motores
+ *  a cada período (veja telemetria.c).
+ */
+
+#ifndef TELEMETRIA_H_
+#define TELEMETRIA_H_
+
+#include <stdint.h>
+
+/* Tamanho dos dados de PROTO_ID_TELEMETRIA */
+#define TELEMETRIA_SIZE (11)
+
+/* Período inicial em ticks do watchdog (~16ms): ~100ms */
+#define TELEMETRIA_PERIODO (6)
+
+void telemetria_periodo(uint16_t periodo);
+uint8_t telemetria_tick();
+uint8_t telemetria_monta(uint8_t *payload, uint16_t distancia);
+
+#endif /* TELEMETRIA_H_ */
@@ -0,0 +1,138 @@
+/*
+ *  Modulo: uart_baudrate.h
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Cálculo em tempo de compilação dos registradores de
+ *  baudrate do eUSCI_A (UCAxBRW e UCAxMCTLW) a partir de
+ *  UART_SMCLK_FREQ e UART_BAUDRATE (veja uart_fr2355.h).
+ *
+ *  Algoritmo do guia da família MSP430FR4xx/FR2xx (eUSCI_A UART,
+ *  "Baud-Rate Settings"):
+ *
+ *  N = fBRCLK / baudrate
+ *
+ *  - Se N >= 16: oversampling (UCOS16 = 1)
+ *      UCBRx  = INT(N / 16)
+ *      UCBRFx = INT(((N / 16) - INT(N / 16)) * 16)
+ *  - Senão: modo de baixa frequência (UCOS16 = 0)
+ *      UCBRx  = INT(N)
+ *  - UCBRSx: tabela de modulação indexada pela parte fracionária
+ *    de N (N - INT(N)).
+ *
+ *  As contas são feitas pelo pré-processador (inteiros de 64 bits),
+ *  portanto nada é calculado no MSP430.
+ *
+ *  Sem proteção contra inclusão múltipla: para cada instância da UART
+ *  defina UART_BAUDRATE e inclua este arquivo novamente.
+ */
+
+#undef UART_N_INT
+#undef UART_N_FRAC
+#undef UART_UCOS16
+#undef UART_UCBRW
+#undef UART_UCBRF
+#undef UART_UCBRS
+#undef UART_UCMCTLW
+
+#if !defined(UART_SMCLK_FREQ) || !defined(UART_BAUDRATE)
+#error "Defina UART_SMCLK_FREQ e UART_BAUDRATE antes de incluir uart_baudrate.h"
+#endif
+
+/* Parte inteira de N */
+#define UART_N_INT (UART_SMCLK_FREQ / UART_BAUDRATE)
+
+/* Parte fracionária de N em décimos de milésimo (0 a 9999) */
+#define UART_N_FRAC (((UART_SMCLK_FREQ % UART_BAUDRATE) * 10000) / UART_BAUDRATE)
+
+#if UART_N_INT < 1
+#error "UART_SMCLK_FREQ muito baixo para o UART_BAUDRATE escolhido"
+#endif
+
+#if UART_N_INT >= 16
+#define UART_UCOS16 (1)
+#define UART_UCBRW  (UART_N_INT / 16)
+#define UART_UCBRF  (UART_N_INT % 16)
+#else
+#define UART_UCOS16 (0)
+#define UART_UCBRW  (UART_N_INT)
+#define UART_UCBRF  (0)
+#endif
+
+/* Tabela de UCBRSx em função da parte fracionária de N */
+#if   UART_N_FRAC >= 9288
+#define UART_UCBRS 0xFE
+#elif UART_N_FRAC >= 9170
+#define UART_UCBRS 0xFD
+#elif UART_N_FRAC >= 9004
+#define UART_UCBRS 0xFB
+#elif UART_N_FRAC >= 8751
+#define UART_UCBRS 0xF7
+#elif UART_N_FRAC >= 8572
+#define UART_UCBRS 0xEF
+#elif UART_N_FRAC >= 8464
+#define UART_UCBRS 0xDF
+#elif UART_N_FRAC >= 8333
+#define UART_UCBRS 0xBF
+#elif UART_N_FRAC >= 8004
+#define UART_UCBRS 0xEE
+#elif UART_N_FRAC >= 7861
+#define UART_UCBRS 0xED
+#elif UART_N_FRAC >= 7503
+#define UART_UCBRS 0xDD
+#elif UART_N_FRAC >= 7147
+#define UART_UCBRS 0xBB
+#elif UART_N_FRAC >= 7001
+#define UART_UCBRS 0xB7
+#elif UART_N_FRAC >= 6667
+#define UART_UCBRS 0xD6
+#elif UART_N_FRAC >= 6432
+#define UART_UCBRS 0xB6
+#elif UART_N_FRAC >= 6254
+#define UART_UCBRS 0xB5
+#elif UART_N_FRAC >= 6003
+#define UART_UCBRS 0xAD
+#elif UART_N_FRAC >= 5715
+#define UART_UCBRS 0x6B
+#elif UART_N_FRAC >= 5002
+#define UART_UCBRS 0xAA
+#elif UART_N_FRAC >= 4378
+#define UART_UCBRS 0x55
+#elif UART_N_FRAC >= 4286
+#define UART_UCBRS 0x53
+#elif UART_N_FRAC >= 4003
+#define UART_UCBRS 0x92
+#elif UART_N_FRAC >= 3753
+#define UART_UCBRS 0x52
+#elif UART_N_FRAC >= 3575
+#define UART_UCBRS 0x4A
+#elif UART_N_FRAC >= 3335
+#define UART_UCBRS 0x49
+#elif UART_N_FRAC >= 3000
+#define UART_UCBRS 0x25
+#elif UART_N_FRAC >= 2503
+#define UART_UCBRS 0x44
+#elif UART_N_FRAC >= 2224
+#define UART_UCBRS 0x22
+#elif UART_N_FRAC >= 2147
+#define UART_UCBRS 0x21
+#elif UART_N_FRAC >= 1670
+#define UART_UCBRS 0x11
+#elif UART_N_FRAC >= 1430
+#define UART_UCBRS 0x20
+#elif UART_N_FRAC >= 1252
+#define UART_UCBRS 0x10
+#elif UART_N_FRAC >= 1001
+#define UART_UCBRS 0x08
+#elif UART_N_FRAC >= 835
+#define UART_UCBRS 0x04
+#elif UART_N_FRAC >= 715
+#define UART_UCBRS 0x02
+#elif UART_N_FRAC >= 529
+#define UART_UCBRS 0x01
+#else
+#define UART_UCBRS 0x00
+#endif
+
+/* Valor final de UCAxMCTLW: UCBRSx | UCBRFx | UCOS16 */
+#define UART_UCMCTLW ((UART_UCBRS << 8) | (UART_UCBRF << 4) | UART_UCOS16)
@@ -6,7 +6,25 @@
  *      Instituto Federal de Santa Catarina
  *
  *      - Biblioteca de comunicação UART.
- *      - Utiliza UCA1 em modo UART 115200 bps
+ *      - Utiliza UCA0 e/ou UCA1 em modo UART. Cada instância tem o seu
+ *        próprio estado (struct uart_t) e a sua ISR; as duas ISRs usam a
+ *        mesma máquina de estados inline. Baudrate em uart_fr2355.h
+ *      - Transmissão e recepção não bloqueantes: main escreve/lê
+ *        buffers circulares que são esvaziados/preenchidos pela ISR.
+ *      - Duas filas de transmissão: a de alta prioridade (alarmes) é
+ *        enviada na próxima fronteira de quadro da fila normal.
+ *      - Controle de fluxo RTS/CTS opcional por GPIO: RTS é desativado
+ *        quando a recepção chega perto de encher e a transmissão pausa
+ *        enquanto o CTS do outro lado estiver desativado.
+ *      - Detecção automática de baudrate opcional (UCABDEN): o host envia
+ *        break + 0x55 e o eUSCI mede e reprograma o baudrate.
+ *      - Contadores por instância de bytes, quadros, erros de recepção
+ *        (overrun, framing, paridade) e ocupação máxima dos buffers.
+ *      - Modo de quadros: a ISR monta um quadro de tamanho variável
+ *        terminado por um byte delimitador ou por um intervalo sem
+ *        recepção medido por um comparador do Timer B0.
+ *        Dois buffers de quadro (ping-pong): a ISR preenche um enquanto
+ *        o main processa o outro no próprio buffer, sem cópias.
  *
  *               MSP430FR2355
  *            -----------------
@@ -18,6 +36,18 @@
  *           |                 |
  *           |    P4.2/UCA1RXD | <-- RX
  *           |                 |
+ *           |    P1.7/UCA0TXD | --> TX
+ *           |                 |
+ *           |    P1.6/UCA0RXD | <-- RX
+ *           |                 |
+ *           |        P3.2/P3.0| --> RTS (UCA1/UCA0, opcional)
+ *           |                 |
+ *           |        P3.3/P3.1| <-- CTS (UCA1/UCA0, opcional)
+ *           |                 |
+ *
+ *      - Timer B0 (SMCLK/8, contagem contínua) é usado como base de
+ *        tempo para o término de quadro por intervalo:
+ *        comparador 1 para UCA1 e comparador 2 para UCA0.
  */
 
 /* System includes */
@@ -26,158 +56,646 @@
 
 /* Project includes */
 #include <uart_fr2355.h>
+#include "ring_buffer.h"
 
 #ifndef __MSP430FR2355__
 #error "Library no supported/validated in this device."
 #endif
 
-struct uart_status_t {
-    /* Estado de envio */
-    uint8_t *data_to_send;
-    uint8_t send_size;
-    uint8_t send_busy;
+#if !RING_SIZE_IS_POW2(UART_TX_BUFFER_SIZE) || !RING_SIZE_IS_POW2(UART_RX_BUFFER_SIZE) \
+    || !RING_SIZE_IS_POW2(UART_TX_HIGH_BUFFER_SIZE)
+#error "Tamanhos dos buffers da UART devem ser potência de 2"
+#endif
+
+#if (UART_RTS_MARGIN * 2 > UART_RX_BUFFER_SIZE) || (UART_RTS_MARGIN >= UART_FRAME_SIZE)
+#error "UART_RTS_MARGIN muito grande para os buffers de recepção"
+#endif
+
+/* Pinos de controle de fluxo de cada instância: 0 desabilita */
+#if UART_A0_FLOW_CONTROL
+#define UART_A0_RTS_PIN UART_A0_RTS
+#define UART_A0_CTS_PIN UART_A0_CTS
+#else
+#define UART_A0_RTS_PIN 0
+#define UART_A0_CTS_PIN 0
+#endif
+
+#if UART_A1_FLOW_CONTROL
+#define UART_A1_RTS_PIN UART_A1_RTS
+#define UART_A1_CTS_PIN UART_A1_CTS
+#else
+#define UART_A1_RTS_PIN 0
+#define UART_A1_CTS_PIN 0
+#endif
+
+/* Pinos pelo endereço base: constantes nas ISRs do eUSCI (base é
+ * constante em cada uma). Sem controle de fluxo em nenhuma instância as
+ * verificações de RTS/CTS não são compiladas; com ele, só na instância
+ * que o usa: uma leitura de P3IN e um teste de bit (~4 ciclos) antes de
+ * cada byte transmitido */
+#define UART_FLOW_CONTROL  (UART_A0_FLOW_CONTROL || UART_A1_FLOW_CONTROL)
+#define UART_RTS_PIN(base) ((base) == EUSCI_A1_BASE ? UART_A1_RTS_PIN : UART_A0_RTS_PIN)
+#define UART_CTS_PIN(base) ((base) == EUSCI_A1_BASE ? UART_A1_CTS_PIN : UART_A0_CTS_PIN)
+
+/* Frequência do Timer B0 usado no término de quadro por intervalo */
+#define UART_TIMER_FREQ (UART_SMCLK_FREQ / 8)
+
+/* Acesso aos registradores do eUSCI_Ax pelo endereço base da instância */
+#define UART_REG(base, ofs) (*(volatile uint16_t *)(uintptr_t)((base) + (ofs)))
+
+struct uart_t {
+    /* Endereço base do eUSCI_Ax e valores de baudrate */
+    uint16_t base;
+    uint16_t brw;
+    uint16_t mctlw;
+    uint8_t autobaud;
+
+    /* Pinos RTS e CTS na porta 3 (0: sem controle de fluxo) */
+    uint8_t rts;
+    uint8_t cts;
+
+    /* Comparador do Timer B0 usado no término de quadro por intervalo */
+    volatile uint16_t *timer_cctl;
+    volatile uint16_t *timer_ccr;
+
+    /* Estado de envio: main escreve, ISR esvazia. Uma fila por
+     * prioridade e a fila do quadro sendo enviado (0 na fronteira) */
+    struct ring_t tx[UART_TX_PRIORITIES];
+    struct ring_t *tx_active;
+
+    /* Estado de recepção: ISR escreve, main esvazia */
+    struct ring_t rx;
+
+    /* Estado de recepção de quadros */
+    uint8_t frame_mode;
+    uint8_t delimiter;
+    uint16_t gap_ticks;
+    /* Buffer sendo preenchido pela ISR e seu tamanho */
+    uint8_t frame_fill;
+    uint8_t frame_size;
+    /* Quadro completo no outro buffer: pertence ao main até ser liberado */
+    uint8_t ready_size;
+    volatile uint8_t frame_ready;
+    uint8_t frame[2][UART_FRAME_SIZE];
+
+    /* Contadores: alterados pelas ISRs, lidos com uart_get_stats() */
+    struct uart_stats_t stats;
+};
+
+#if UART_USE_UCA0
+#define UART_BAUDRATE UART_A0_BAUDRATE
+#include "uart_baudrate.h"
+
+static uint8_t uca0_tx_buffer[UART_TX_BUFFER_SIZE];
+static uint8_t uca0_tx_high_buffer[UART_TX_HIGH_BUFFER_SIZE];
+static uint8_t uca0_rx_buffer[UART_RX_BUFFER_SIZE];
+
+struct uart_t uart_a0 = {
+    EUSCI_A0_BASE, UART_UCBRW, UART_UCMCTLW, UART_A0_AUTOBAUD,
+    UART_A0_RTS_PIN, UART_A0_CTS_PIN,
+    &TB0CCTL2, &TB0CCR2,
+    { RING_INIT(uca0_tx_buffer), RING_INIT(uca0_tx_high_buffer) }, 0,
+    RING_INIT(uca0_rx_buffer)
+};
+#undef UART_BAUDRATE
+#endif
+
+#if UART_USE_UCA1
+#define UART_BAUDRATE UART_A1_BAUDRATE
+#include "uart_baudrate.h"
 
-    /* Estado de recepção */
-    uint8_t *data_to_receive;
-    uint8_t receive_size;
-    uint8_t receive_busy;
+static uint8_t uca1_tx_buffer[UART_TX_BUFFER_SIZE];
+static uint8_t uca1_tx_high_buffer[UART_TX_HIGH_BUFFER_SIZE];
+static uint8_t uca1_rx_buffer[UART_RX_BUFFER_SIZE];
+
+struct uart_t uart_a1 = {
+    EUSCI_A1_BASE, UART_UCBRW, UART_UCMCTLW, UART_A1_AUTOBAUD,
+    UART_A1_RTS_PIN, UART_A1_CTS_PIN,
+    &TB0CCTL1, &TB0CCR1,
+    { RING_INIT(uca1_tx_buffer), RING_INIT(uca1_tx_high_buffer) }, 0,
+    RING_INIT(uca1_rx_buffer)
 };
+#undef UART_BAUDRATE
+#endif
+
+/* Habilita a IRQ de transmissão se há dados e o outro lado aceita
+ * (CTS baixo). Usada pelo main e pela ISR da porta 3. */
+static inline void uart_tx_enable(struct uart_t *uart){
+
+#if UART_FLOW_CONTROL
+    if (P3IN & uart->cts)
+        return;
+#endif
+
+    if (!ring_empty(&uart->tx[UART_PRIO_NORMAL]) || !ring_empty(&uart->tx[UART_PRIO_HIGH]))
+        UART_REG(uart->base, OFS_UCAxIE) |= UCTXIE;
+}
+
+/* Configura o eUSCI da instância. UCSWRST desliga as IRQs,
+ * portanto elas são reabilitadas no final. */
+static void uart_configure(struct uart_t *uart){
 
-volatile struct uart_status_t uart_status = {0};
+    UART_REG(uart->base, OFS_UCAxCTLW0) |= UCSWRST;
+    /* Fonte de clock SMCLK
+     * UCRXEIE: bytes com erro também geram IRQ para serem contados */
+    UART_REG(uart->base, OFS_UCAxCTLW0) |= UCSSEL_2 | UCRXEIE;
+
+    /* Valores calculados em uart_baudrate.h. Para 24MHz e 115200 bps:
+     * UCBRx = 13, UCBRFx = 0, UCBRSx = 0x25, UCOS16 = 1
+     * Veja http://software-dl.ti.com/msp430/msp430_public_sw/mcu/msp430/MSP430BaudRateConverter/index.html */
+    UART_REG(uart->base, OFS_UCAxBRW) = uart->brw;
+    UART_REG(uart->base, OFS_UCAxMCTLW) = uart->mctlw;
+
+    if (uart->autobaud){
+        /* UCMODE_3: UART com detecção automática de baudrate
+         * UCBRKIE: break/sincronismo gera IRQ de recepção */
+        UART_REG(uart->base, OFS_UCAxCTLW0) |= UCMODE_3 | UCBRKIE;
+        /* UCABDEN: mede o campo de sincronismo e ajusta UCBRx/UCBRFx.
+         * UCBRSx não é calculado pelo hardware: modulação fina desligada */
+        UART_REG(uart->base, OFS_UCAxABCTL) = UCABDEN | UCDELIM_0;
+        UART_REG(uart->base, OFS_UCAxMCTLW) &= ~0xff00;
+    }
+    else {
+        UART_REG(uart->base, OFS_UCAxCTLW0) &= ~(UCMODE_3 | UCBRKIE);
+        UART_REG(uart->base, OFS_UCAxABCTL) = 0;
+    }
+
+    /* Initicialização do eUSCI */
+    UART_REG(uart->base, OFS_UCAxCTLW0) &= ~UCSWRST;
+
+    /* Habilitação da ISR de recepção. A de transmissão é
+     * habilitada somente quando há dados no buffer */
+    UART_REG(uart->base, OFS_UCAxIE) |= UCRXIE;
+    uart_tx_start(uart);
+}
 
 /**
- * @brief  Configura o hardware USCI0 para UART com baudrate em 115200.
- *         FLL em 24 MHz. Ajustar o baudrate conforme a frequência de
- *         operação da CPU
+ * @brief  Configura uma instância do eUSCI_A para UART.
+ *         Registradores de baudrate calculados para UART_SMCLK_FREQ:
+ *         ajuste UART_SMCLK_FREQ conforme a configuração do clock.
  *
- * @param  none
+ * @param  uart: instância (UART_A0 ou UART_A1).
  *
  * @retval none
  */
-void init_uart(){
+void init_uart(struct uart_t *uart){
     /* Função alternativa dos pinos:
-     * - P4.2 = RXD
-     * - P4.3 = TXD
+     * - UCA1: P4.2 = RXD, P4.3 = TXD
+     * - UCA0: P1.6 = RXD, P1.7 = TXD
      */
-    P4SEL0 = BIT2 | BIT3;
+    if (uart->base == EUSCI_A1_BASE)
+        P4SEL0 |= BIT2 | BIT3;
+    else
+        P1SEL0 |= BIT6 | BIT7;
 
-#ifdef CLOCK_24MHz
-    UCA1CTLW0 |= UCSWRST;
-    /* Fonte de clock SMCLK */
-    UCA1CTLW0 |= UCSSEL_2;
+    /* RTS: saída, começa ativo (baixo) */
+    P3DIR |= uart->rts;
+    P3OUT &= ~uart->rts;
 
-    /* Veja http://software-dl.ti.com/msp430/msp430_public_sw/mcu/msp430/MSP430BaudRateConverter/index.html */
-    UCA1BR0 = 13;
-    UCA1BR1 = 0;
-    UCA1MCTLW = 0x2500 | UCOS16;
-#else
-#error "Clock system not defined for UART support"
-#endif
+    /* CTS: entrada com pull-down e IRQ na borda de descida (outro
+     * lado volta a aceitar dados). A subida é verificada pela ISR
+     * de transmissão antes de cada byte. */
+    P3DIR &= ~uart->cts;
+    P3OUT &= ~uart->cts;
+    P3REN |= uart->cts;
+    P3IES |= uart->cts;
+    P3IFG &= ~uart->cts;
+    P3IE |= uart->cts;
 
-    /* Initicialização do eUSCI */
-    UCA1CTLW0 &= ~UCSWRST;
+    uart_configure(uart);
+}
 
-    /* Habilitação da ISR */
-    UCA1IE |= UCRXIE | UCTXIE;
+/**
+ * @brief  Liga ou desliga a detecção automática de baudrate.
+ *         Ao desligar, o baudrate volta ao valor de compilação.
+ *         Bytes em transmissão/recepção no momento podem ser perdidos.
+ *
+ * @param  uart: instância.
+ *         enable: 1 liga, 0 desliga.
+ *
+ * @retval none
+ */
+void uart_autobaud(struct uart_t *uart, uint8_t enable){
+    uart->autobaud = enable;
+    uart_configure(uart);
+}
+
+/**
+ * @brief  Baudrate atual da instância, lido dos registradores (inclui o
+ *         valor medido pela detecção automática). Usa divisão de 32 bits:
+ *         não chamar em ISR.
+ *
+ * @retval baudrate em bps.
+ */
+uint32_t uart_baudrate(struct uart_t *uart){
+
+    uint32_t brw = UART_REG(uart->base, OFS_UCAxBRW);
+    uint16_t mctlw = UART_REG(uart->base, OFS_UCAxMCTLW);
+
+    /* Com oversampling: N = 16 * UCBRx + UCBRFx */
+    if (mctlw & UCOS16)
+        brw = (brw << 4) + ((mctlw >> 4) & 0x0f);
+
+    if (brw == 0)
+        return 0;
+
+    return UART_SMCLK_FREQ / brw;
 }
 
 
 /**
- * @brief  Envia um pacote para o ESCI.
- *         Utiliza IRQ de transmissão para o envio dos bytes.
+ * @brief  Coloca um pacote no buffer de transmissão.
+ *         Não bloqueia: a IRQ de transmissão envia os bytes
+ *         enquanto o main continua executando.
  *
  *         Use com IRS habilitadas.
  *
- * @param  data: endereço inicial dos dados do pacote.
+ * @param  uart: instância.
+ *         data: endereço inicial dos dados do pacote.
  *         size: tamanho do pacote.
  *
- * @retval none
+ *         Tudo ou nada: a ISR trata o fim dos dados publicados como
+ *         fronteira de quadro, e um pacote cortado deixaria um alarme
+ *         entrar no meio dele.
+ *
+ *         A ISR também troca de fila depois de cada byte
+ *         UART_TX_DELIMITER: dados sem COBS com 0x00 no meio podem ser
+ *         interrompidos por um alarme nesse ponto.
+ *
+ * @retval size, ou 0 se não há espaço para o pacote inteiro.
  */
-void uart_send_package(uint8_t *data, uint8_t size){
+uint8_t uart_send_package(struct uart_t *uart, const uint8_t *data, uint8_t size){
 
-    /* Serializa a transmissão de vários pacotes */
-    while (uart_status.send_busy != 0);
+    uint8_t n;
 
-    /* Condições de estado */
-    uart_status.data_to_send = data;
-    uart_status.send_size = size - 1;
-    uart_status.send_busy = 1;
+    if (ring_free(&uart->tx[UART_PRIO_NORMAL]) < size)
+        return 0;
 
-    /* Envia primeiro byte */
-    UCA1TXBUF = data[0];
+    n = ring_write(&uart->tx[UART_PRIO_NORMAL], data, size);
+
+    /* Habilita IRQ de transmissão: UCTXIFG já está ativo se o
+     * transmissor estiver livre, então a ISR envia o primeiro byte */
+    if (n)
+        uart_tx_start(uart);
+
+    return n;
 }
 
 /**
- * @brief  Recebe um pacote do ESCI.
- *         Utiliza IRQ de recebimento de cada byte.
- *
- *         Use com IRS habilitadas.
+ * @brief  Coloca um pacote na fila de alta prioridade: é enviado logo
+ *         após o quadro da fila normal que estiver em andamento.
  *
- * @param  data: endereço inicial dos dados do pacote.
+ * @param  uart: instância.
+ *         data: endereço inicial dos dados do pacote.
  *         size: tamanho do pacote.
  *
+ *         Tudo ou nada, como uart_send_package().
+ *
+ * @retval size, ou 0 se não há espaço para o pacote inteiro.
+ */
+uint8_t uart_send_priority(struct uart_t *uart, const uint8_t *data, uint8_t size){
+
+    uint8_t n;
+
+    if (ring_free(&uart->tx[UART_PRIO_HIGH]) < size)
+        return 0;
+
+    n = ring_write(&uart->tx[UART_PRIO_HIGH], data, size);
+
+    if (n)
+        uart_tx_start(uart);
+
+    return n;
+}
+
+/**
+ * @brief  Retira bytes recebidos do buffer de recepção.
+ *         Não bloqueia: retorna somente o que já chegou.
+ *
+ * @param  uart: instância.
+ *         data: endereço onde os dados são copiados.
+ *         size: tamanho máximo a copiar.
+ *
+ * @retval quantidade de bytes copiados.
+ */
+uint8_t uart_receive_package(struct uart_t *uart, uint8_t *data, uint8_t size){
+
+    uint8_t n = ring_read(&uart->rx, data, size);
+
+    uart_rx_resume(uart);
+
+    return n;
+}
+
+/**
+ * @brief  Reativa RTS se há espaço no buffer de recepção. Chamada por
+ *         uart_receive_package(); chame após ler direto de uart_rx_ring().
+ */
+void uart_rx_resume(struct uart_t *uart){
+
+    /* Histerese: só reativa com o dobro da margem livre.
+     * bic.b é uma instrução só: não conflita com a ISR da outra instância */
+    if (ring_free(&uart->rx) >= UART_RTS_MARGIN * 2)
+        P3OUT &= ~uart->rts;
+}
+
+/**
+ * @brief  Quantidade de bytes esperando no buffer de recepção.
+ */
+uint8_t uart_rx_available(struct uart_t *uart){
+    return ring_count(&uart->rx);
+}
+
+/**
+ * @brief  Espaço livre na fila de transmissão da prioridade prio.
+ */
+uint8_t uart_tx_free(struct uart_t *uart, uint8_t prio){
+    return ring_free(&uart->tx[prio]);
+}
+
+
+/**
+ * @brief  Acesso direto aos buffers circulares para codificação e
+ *         decodificação sem cópias intermediárias (veja protocolo.c).
+ *         Após escrever no buffer de transmissão chame uart_tx_start().
+ */
+struct ring_t *uart_tx_ring(struct uart_t *uart, uint8_t prio){
+    return &uart->tx[prio];
+}
+
+struct ring_t *uart_rx_ring(struct uart_t *uart){
+    return &uart->rx;
+}
+
+/**
+ * @brief  Inicia o envio do que foi escrito direto no buffer de transmissão.
+ */
+void uart_tx_start(struct uart_t *uart){
+
+    uint16_t count = ring_count(&uart->tx[UART_PRIO_NORMAL]) +
+                     ring_count(&uart->tx[UART_PRIO_HIGH]);
+
+    /* tx_peak só é alterado pelo main */
+    if (count > uart->stats.tx_peak)
+        uart->stats.tx_peak = count;
+
+    uart_tx_enable(uart);
+}
+
+/**
+ * @brief  Configura a recepção de quadros de tamanho variável.
+ *         Com mode diferente de UART_FRAME_OFF os bytes recebidos não vão
+ *         para o buffer circular: a ISR monta um quadro e só acorda o main
+ *         quando ele termina.
+ *
+ * @param  uart: instância.
+ *         mode: UART_FRAME_OFF ou combinação de UART_FRAME_DELIMITER
+ *               e UART_FRAME_IDLE.
+ *         delimiter: byte que termina o quadro (não é armazenado).
+ *         gap_us: intervalo sem recepção que termina o quadro, em us.
+ *                 Máximo de 65535 contagens do Timer B0 (~21ms em 24MHz).
+ *
  * @retval none
  */
-void uart_receive_package(uint8_t *data, uint8_t size){
+void uart_frame_mode(struct uart_t *uart, uint8_t mode, uint8_t delimiter, uint16_t gap_us){
+
+    uint32_t ticks = ((uint32_t)gap_us * (UART_TIMER_FREQ / 1000)) / 1000;
+
+    if (ticks > 0xffff)
+        ticks = 0xffff;
+
+    /* Desliga recepção de quadros durante a configuração */
+    UART_REG(uart->base, OFS_UCAxIE) &= ~UCRXIE;
+    *uart->timer_cctl = 0;
+
+    uart->frame_mode = mode;
+    uart->delimiter = delimiter;
+    uart->gap_ticks = ticks;
+    uart->frame_fill = 0;
+    uart->frame_size = 0;
+    uart->frame_ready = 0;
+
+    /* Timer B0 é compartilhado pelas instâncias: só é configurado uma vez
+     * TBSSEL_2 -> Clock de SMCLK.
+     * MC_2 -> Contagem contínua.
+     * ID_3 -> Prescaler = /8
+     */
+    if ((mode & UART_FRAME_IDLE) && !(TB0CTL & MC_2))
+        TB0CTL = TBSSEL_2 | MC_2 | ID_3 | TBCLR;
+
+    UART_REG(uart->base, OFS_UCAxIE) |= UCRXIE;
+}
+
+/**
+ * @brief  Obtém o último quadro completo.
+ *         O buffer pertence ao main até uart_frame_release() e pode ser
+ *         alterado no lugar (ex.: decodificação COBS). Enquanto isso a
+ *         ISR continua recebendo o próximo quadro no outro buffer.
+ *
+ * @param  uart: instância.
+ *         size: tamanho do quadro em bytes.
+ *
+ * @retval endereço do quadro ou 0 se não há quadro completo.
+ */
+uint8_t *uart_frame_get(struct uart_t *uart, uint8_t *size){
 
-    /* Serializa a transmissão de vários pacotes */
-    while (uart_status.receive_busy != 0);
+    if (!uart->frame_ready)
+        return 0;
 
-    /*r Condições de estado */
-    uart_status.data_to_receive = data;
-    uart_status.receive_size = size;
-    uart_status.receive_busy = 1;
+    *size = uart->ready_size;
+    return uart->frame[uart->frame_fill ^ 1];
 }
 
+/**
+ * @brief  Devolve o buffer de quadro para a ISR.
+ */
+void uart_frame_release(struct uart_t *uart){
+    uart->frame_ready = 0;
 
-/* ISR da EUSCI: acontece quando algum byte é recebido, transmitido, etc
- * conforme habilitações na inicialização  */
-#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
-#pragma vector=USCI_A1_VECTOR
-__interrupt void USCI_A1_ISR(void)
-#elif defined(__GNUC__)
-void __attribute__ ((interrupt(USCI_A1_VECTOR))) USCI_A1_ISR (void)
-#else
-#error Compiler not supported!
-#endif
-{
-    volatile uint8_t data;
+    /* Os dois buffers estão livres novamente */
+    P3OUT &= ~uart->rts;
+}
+
+/**
+ * @brief  Copia os contadores da instância. As ISRs são desligadas
+ *         durante a cópia para não misturar valores antigos e novos.
+ */
+void uart_get_stats(struct uart_t *uart, struct uart_stats_t *stats){
+
+    uint16_t state = __get_interrupt_state();
+
+    __disable_interrupt();
+    *stats = uart->stats;
+    __set_interrupt_state(state);
+}
+
+/**
+ * @brief  Zera os contadores da instância.
+ */
+void uart_clear_stats(struct uart_t *uart){
+
+    uint16_t state = __get_interrupt_state();
+    uint8_t *p = (uint8_t *)&uart->stats;
+    uint8_t i;
 
-    switch(__even_in_range(UCA1IV,USCI_UART_UCTXCPTIFG))
+    __disable_interrupt();
+    for (i = 0; i < sizeof(uart->stats); i++)
+        p[i] = 0;
+    __set_interrupt_state(state);
+}
+
+/* Termina o quadro atual e troca os buffers: executado somente dentro
+ * das ISRs. Retorna 1 se um quadro foi entregue ao main. */
+static inline uint8_t frame_complete(struct uart_t *uart){
+
+    *uart->timer_cctl = 0;
+
+    /* Main ainda processa o outro buffer: quadro descartado */
+    if (uart->frame_ready){
+        uart->frame_size = 0;
+        uart->stats.frames_dropped++;
+        return 0;
+    }
+
+    uart->stats.frames++;
+
+    uart->ready_size = uart->frame_size;
+    uart->frame_fill ^= 1;
+    uart->frame_size = 0;
+    uart->frame_ready = 1;
+
+    return 1;
+}
+
+/* Máquina de estados compartilhada pelas ISRs do eUSCI.
+ * base é constante em cada ISR: com a função inline o compilador
+ * acessa os registradores da instância diretamente.
+ * Retorna 1 se o main deve ser acordado. */
+static inline uint8_t uart_isr(struct uart_t *uart, const uint16_t base){
+
+    uint8_t data;
+    uint16_t status;
+    uint16_t count;
+
+    switch(__even_in_range(UART_REG(base, OFS_UCAxIV), USCI_UART_UCTXCPTIFG))
     {
         case USCI_NONE:
             break;
         case USCI_UART_UCRXIFG:     /* Received IRQ */
-            data = UCA1RXBUF;
-
-            if (uart_status.receive_busy)
-            {
-                /* Guarda dados */
-                *(uart_status.data_to_receive++) = data;
-                uart_status.receive_size--;
-
-                /* Se todos os dados foram recebidos,
-                 * acorda main e desliga recepção */
-                if (uart_status.receive_size == 0){
-                    uart_status.receive_busy = 0;
-                    __bic_SR_register_on_exit(CPUOFF);
+            /* Status deve ser lido antes de UCAxRXBUF: a leitura
+             * do dado limpa as flags de erro */
+            status = UART_REG(base, OFS_UCAxSTATW);
+            data = UART_REG(base, OFS_UCAxRXBUF);
+
+            /* Break + sincronismo da detecção automática de baudrate:
+             * não é dado. UCBTOE/UCSTOE indicam falha na medição. */
+            if (status & UCBRK){
+                if (UART_REG(base, OFS_UCAxABCTL) & (UCBTOE | UCSTOE)){
+                    UART_REG(base, OFS_UCAxABCTL) &= ~(UCBTOE | UCSTOE);
+                    uart->stats.autobaud_errors++;
                 }
+                else
+                    uart->stats.autobaud_syncs++;
+                break;
+            }
+
+            if (status & UCRXERR){
+                if (status & UCOE)
+                    uart->stats.overruns++;
+                if (status & UCFE)
+                    uart->stats.framing_errors++;
+                if (status & UCPE)
+                    uart->stats.parity_errors++;
+
+                /* Erro de framing ou paridade: dado inválido é descartado.
+                 * No overrun o dado atual é válido, o anterior foi perdido */
+                if (status & (UCFE | UCPE))
+                    break;
+            }
+
+            uart->stats.rx_bytes++;
+
+            if (uart->frame_mode == UART_FRAME_OFF){
+                /* Guarda dados. Se o buffer estiver cheio o byte é descartado */
+                if (ring_free(&uart->rx)){
+                    ring_put(&uart->rx, data);
+
+                    count = ring_count(&uart->rx);
+                    if (count > uart->stats.rx_peak)
+                        uart->stats.rx_peak = count;
+
+#if UART_FLOW_CONTROL
+                    /* Perto de encher: pede para o outro lado parar */
+                    if (UART_RTS_PIN(base) && ring_free(&uart->rx) <= UART_RTS_MARGIN)
+                        P3OUT |= UART_RTS_PIN(base);
+#endif
+                }
+                else
+                    uart->stats.rx_dropped++;
+
+                /* Acorda main para processar os dados */
+                return 1;
+            }
+
+            if ((uart->frame_mode & UART_FRAME_DELIMITER) &&
+                    data == uart->delimiter){
+                /* Delimitador sem dados não gera quadro */
+                return uart->frame_size && frame_complete(uart);
+            }
+
+            uart->frame[uart->frame_fill][uart->frame_size++] = data;
+
+            /* Buffer cheio: entrega o que foi recebido */
+            if (uart->frame_size == UART_FRAME_SIZE)
+                return frame_complete(uart);
+
+#if UART_FLOW_CONTROL
+            /* Main ainda com o outro buffer e este perto de encher:
+             * pede para o outro lado parar até uart_frame_release() */
+            if (UART_RTS_PIN(base) && uart->frame_ready &&
+                    uart->frame_size >= UART_FRAME_SIZE - UART_RTS_MARGIN)
+                P3OUT |= UART_RTS_PIN(base);
+#endif
+
+            /* Reinicia a contagem do intervalo entre bytes */
+            if (uart->frame_mode & UART_FRAME_IDLE){
+                *uart->timer_ccr = TB0R + uart->gap_ticks;
+                *uart->timer_cctl = CCIE;
             }
             break;
 
         case USCI_UART_UCTXIFG:     /* Transmit IRQ */
-            if (uart_status.send_size != 0){
-                UCA1TXBUF = *(++uart_status.data_to_send);
-                uart_status.send_size--;
+            /* CTS desativado: pausa até a borda de descida (ISR da porta 3).
+             * O byte já no registrador de deslocamento termina de ser enviado */
+#if UART_FLOW_CONTROL
+            if (UART_CTS_PIN(base) && (P3IN & UART_CTS_PIN(base))){
+                UART_REG(base, OFS_UCAxIE) &= ~UCTXIE;
+                break;
             }
-            else {
-                /* Condições de término de envio de pacote */
-                /* Desbloqueia serialização de pacotes */
-                uart_status.send_busy = 0;
-                /* Limpa flag de final de transmissão pois não há
-                 * mais nada a enviar          */
-                __bic_SR_register_on_exit(CPUOFF);
+#endif
+
+            /* Fronteira de quadro: escolhe a fila, alta prioridade primeiro */
+            if (!uart->tx_active){
+                if (!ring_empty(&uart->tx[UART_PRIO_HIGH]))
+                    uart->tx_active = &uart->tx[UART_PRIO_HIGH];
+                else if (!ring_empty(&uart->tx[UART_PRIO_NORMAL]))
+                    uart->tx_active = &uart->tx[UART_PRIO_NORMAL];
+                else {
+                    /* Condições de término de envio: não há mais nada
+                     * a enviar, desliga IRQ até o próximo pacote */
+                    UART_REG(base, OFS_UCAxIE) &= ~UCTXIE;
+                    break;
+                }
             }
+
+            data = ring_get(uart->tx_active);
+            UART_REG(base, OFS_UCAxTXBUF) = data;
+            uart->stats.tx_bytes++;
+
+            /* Fim de quadro ou dos dados publicados: os produtores publicam
+             * quadros inteiros, então a fila vazia também é fronteira */
+            if (data == UART_TX_DELIMITER || ring_empty(uart->tx_active))
+                uart->tx_active = 0;
             break;
 
         case USCI_UART_UCSTTIFG:    /*  START byte received interrupt. */
@@ -186,5 +704,115 @@ void __attribute__ ((interrupt(USCI_A1_VECTOR))) USCI_A1_ISR (void)
             break;
 
         default: break;
-        }
+    }
+
+    return 0;
+}
+
+/* Fim do intervalo sem recepção: executado na ISR do Timer B0 */
+static inline uint8_t uart_frame_timeout(struct uart_t *uart){
+
+    if (uart->frame_size && frame_complete(uart))
+        return 1;
+
+    *uart->timer_cctl = 0;
+    return 0;
+}
+
+
+#if UART_USE_UCA0
+/* ISR da EUSCI A0: acontece quando algum byte é recebido, transmitido, etc
+ * conforme habilitações na inicialização  */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=USCI_A0_VECTOR
+__interrupt void USCI_A0_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(USCI_A0_VECTOR))) USCI_A0_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if (uart_isr(&uart_a0, EUSCI_A0_BASE))
+        __bic_SR_register_on_exit(CPUOFF);
+}
+#endif
+
+
+#if UART_USE_UCA1
+/* ISR da EUSCI A1: acontece quando algum byte é recebido, transmitido, etc
+ * conforme habilitações na inicialização  */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=USCI_A1_VECTOR
+__interrupt void USCI_A1_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(USCI_A1_VECTOR))) USCI_A1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    if (uart_isr(&uart_a1, EUSCI_A1_BASE))
+        __bic_SR_register_on_exit(CPUOFF);
+}
+#endif
+
+
+#if UART_A0_FLOW_CONTROL || UART_A1_FLOW_CONTROL
+/* ISR da porta 3: CTS ativado, retoma a transmissão pausada */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector=PORT3_VECTOR
+__interrupt void PORT3_ISR(void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(PORT3_VECTOR))) PORT3_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+#if UART_USE_UCA0 && UART_A0_FLOW_CONTROL
+    if (P3IFG & UART_A0_CTS){
+        P3IFG &= ~UART_A0_CTS;
+        uart_tx_enable(&uart_a0);
+    }
+#endif
+#if UART_USE_UCA1 && UART_A1_FLOW_CONTROL
+    if (P3IFG & UART_A1_CTS){
+        P3IFG &= ~UART_A1_CTS;
+        uart_tx_enable(&uart_a1);
+    }
+#endif
+}
+#endif
+
+
+/* ISR1 do Timer B0: comparadores 1 (UCA1) e 2 (UCA0) marcam o fim do
+ * intervalo sem recepção */
+#if defined(__TI_COMPILER_VERSION__) || defined(__IAR_SYSTEMS_ICC__)
+#pragma vector = TIMER0_B1_VECTOR
+__interrupt void TIMER0_B1_ISR (void)
+#elif defined(__GNUC__)
+void __attribute__ ((interrupt(TIMER0_B1_VECTOR))) TIMER0_B1_ISR (void)
+#else
+#error Compiler not supported!
+#endif
+{
+    switch(__even_in_range(TB0IV,TBxIV_TBIFG))
+    {
+#if UART_USE_UCA1
+    /* Vector  2:  TBCCR1 CCIFG -> Fim do quadro por intervalo em UCA1 */
+    case TBxIV_TBCCR1:
+        if (uart_frame_timeout(&uart_a1))
+            __bic_SR_register_on_exit(CPUOFF);
+        break;
+#endif
+
+#if UART_USE_UCA0
+    /* Vector  4:  TBCCR2 CCIFG -> Fim do quadro por intervalo em UCA0 */
+    case TBxIV_TBCCR2:
+        if (uart_frame_timeout(&uart_a0))
+            __bic_SR_register_on_exit(CPUOFF);
+        break;
+#endif
+
+    default:
+        break;
+    }
 }
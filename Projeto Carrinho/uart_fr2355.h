@@ -10,11 +10,122 @@
 #define LIB_UART_FR2355_H_
 
 #include <stdint.h>
+#include "ring_buffer.h"
 
-#define CLOCK_24MHz
+/* Instâncias do eUSCI_A em modo UART: 1 habilita, 0 desabilita
+ * - UCA0: P1.7 = TXD, P1.6 = RXD
+ * - UCA1: P4.3 = TXD, P4.2 = RXD
+ * O carrinho usa só a UCA1: a UCA0 desabilitada não ocupa RAM com
+ * buffers nem liga a sua ISR.
+ */
+#define UART_USE_UCA0 (0)
+#define UART_USE_UCA1 (1)
+
+/* Frequência do SMCLK (fonte de clock do eUSCI) e baudrate de cada
+ * instância. Os registradores de baudrate são calculados em tempo de
+ * compilação por uart_baudrate.h: basta alterar estes valores. */
+#define UART_SMCLK_FREQ (24000000UL)
+#define UART_A0_BAUDRATE (115200UL)
+#define UART_A1_BAUDRATE (115200UL)
+
+/* Detecção automática de baudrate (UCABDEN): 1 habilita, 0 desabilita.
+ * O host envia um break seguido do caractere de sincronismo 0x55 e o
+ * eUSCI reprograma UCAxBRW e UCBRFx. UCAx_BAUDRATE é o valor inicial. */
+#define UART_A0_AUTOBAUD (0)
+#define UART_A1_AUTOBAUD (0)
+
+/* Controle de fluxo RTS/CTS por GPIO: 1 habilita, 0 desabilita.
+ * Sinais ativos em nível baixo, na porta 3:
+ * - UCA0: P3.0 = RTS (saída), P3.1 = CTS (entrada)
+ * - UCA1: P3.2 = RTS (saída), P3.3 = CTS (entrada)
+ * RTS alto pede para o outro lado parar de enviar. CTS alto (do outro
+ * lado) pausa a transmissão; CTS desconectado fica baixo (pull-down). */
+#define UART_A0_FLOW_CONTROL (0)
+#define UART_A1_FLOW_CONTROL (0)
+#define UART_A0_RTS (BIT0)
+#define UART_A0_CTS (BIT1)
+#define UART_A1_RTS (BIT2)
+#define UART_A1_CTS (BIT3)
+
+/* Espaço livre na recepção quando RTS é desativado: bytes que o outro
+ * lado ainda pode enviar antes de parar (ex.: FIFO de conversores USB) */
+#define UART_RTS_MARGIN (8)
+
+/* Tamanho dos buffers circulares: devem ser potência de 2 */
+#define UART_TX_BUFFER_SIZE (64)
+#define UART_TX_HIGH_BUFFER_SIZE (32)
+#define UART_RX_BUFFER_SIZE (32)
+
+/* Filas de transmissão: a de alta prioridade é enviada primeiro, sempre
+ * entre quadros da fila normal (fim de quadro: byte UART_TX_DELIMITER
+ * ou fim dos dados já publicados na fila). Os pacotes são publicados
+ * inteiros; dados sem COBS não podem contar com 0x00 como fronteira:
+ * um alarme pode ser enviado depois de qualquer 0x00 */
+#define UART_PRIO_NORMAL   (0)
+#define UART_PRIO_HIGH     (1)
+#define UART_TX_PRIORITIES (2)
+#define UART_TX_DELIMITER  (0x00)
+
+/* Recepção de quadros de tamanho variável (uart_frame_mode) */
+#define UART_FRAME_SIZE (32)
+
+/* Condições de término de quadro: podem ser combinadas */
+#define UART_FRAME_OFF       (0x00)
+#define UART_FRAME_DELIMITER (0x01)
+#define UART_FRAME_IDLE      (0x02)
+
+/* Estado de uma instância: definido em uart_fr2355.c */
+struct uart_t;
+
+/* Contadores de erros e de vazão de uma instância */
+struct uart_stats_t {
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    /* Quadros entregues ao main (modo de quadros) */
+    uint16_t frames;
+    /* Erros sinalizados em UCAxSTATW */
+    uint16_t overruns;
+    uint16_t framing_errors;
+    uint16_t parity_errors;
+    /* Bytes descartados com o buffer circular de recepção cheio */
+    uint16_t rx_dropped;
+    /* Quadros descartados com o outro buffer ainda com o main */
+    uint16_t frames_dropped;
+    /* Máxima ocupação dos buffers circulares em bytes */
+    uint16_t tx_peak;
+    uint16_t rx_peak;
+    /* Detecção automática de baudrate: sincronismos e erros de
+     * break/sincronismo (UCBTOE/UCSTOE) */
+    uint16_t autobaud_syncs;
+    uint16_t autobaud_errors;
+};
+
+#if UART_USE_UCA0
+extern struct uart_t uart_a0;
+#define UART_A0 (&uart_a0)
+#endif
+
+#if UART_USE_UCA1
+extern struct uart_t uart_a1;
+#define UART_A1 (&uart_a1)
+#endif
 
-void init_uart();
-void uart_send_package(uint8_t *data, uint8_t size);
-void uart_receive_package(uint8_t *data, uint8_t size);
+void init_uart(struct uart_t *uart);
+uint8_t uart_send_package(struct uart_t *uart, const uint8_t *data, uint8_t size);
+uint8_t uart_send_priority(struct uart_t *uart, const uint8_t *data, uint8_t size);
+uint8_t uart_receive_package(struct uart_t *uart, uint8_t *data, uint8_t size);
+uint8_t uart_rx_available(struct uart_t *uart);
+void uart_rx_resume(struct uart_t *uart);
+uint8_t uart_tx_free(struct uart_t *uart, uint8_t prio);
+struct ring_t *uart_tx_ring(struct uart_t *uart, uint8_t prio);
+struct ring_t *uart_rx_ring(struct uart_t *uart);
+void uart_tx_start(struct uart_t *uart);
+void uart_frame_mode(struct uart_t *uart, uint8_t mode, uint8_t delimiter, uint16_t gap_us);
+uint8_t *uart_frame_get(struct uart_t *uart, uint8_t *size);
+void uart_frame_release(struct uart_t *uart);
+void uart_get_stats(struct uart_t *uart, struct uart_stats_t *stats);
+void uart_clear_stats(struct uart_t *uart);
+void uart_autobaud(struct uart_t *uart, uint8_t enable);
+uint32_t uart_baudrate(struct uart_t *uart);
 
 #endif /* LIB_UART_FR2355_H_ */
@@ -0,0 +1,217 @@
+/*
+ *  Modulo: varredura.c
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Sensor da frente em um servo que varre os ângulos de
+ *  VARREDURA_ANGULO_MIN a VARREDURA_ANGULO_MAX, indo e voltando. Cada
+ *  medição é guardada no mapa polar, um valor por ângulo: o caminho
+ *  mais livre sai de uma passada no mapa (varredura_livre), sem parar
+ *  o carrinho para olhar para os lados.
+ *
+ *  - Servo com PWM de 50Hz no Timer B2 (modo up, CCR0 = período) e
+ *    pulso em TB2.1 (OUTMOD_7: sobe no início do período e desce em
+ *    CCR1). CLLD_1: o novo CCR1 só vale no início do período seguinte,
+ *    o servo nunca recebe um pulso cortado ou dobrado.
+ *  - O Timer B2 é o do segundo sensor: SONAR_VARREDURA só com
+ *    SONAR_SENSORES 1.
+ *  - varredura_passo() é chamada pelas ISRs do sensor no fim de cada
+ *    medição: o servo vai para o ângulo seguinte enquanto o sensor
+ *    cumpre o intervalo mínimo entre disparos (ecos atrasados), e o
+ *    disparo seguinte espera só o que faltar para o servo assentar.
+ *  - Medição perdida fica SONAR_MM_INVALIDO no mapa (ignorada);
+ *    sem alvo fica com a distância do eco máximo (livre).
+ *
+ *                MSP430FR2355
+ *            -----------------
+ *           |       P5.0/TB2.1| --> Servo (PWM 50Hz)
+ *           |                 |
+ */
+
+#include <msp430.h>
+/* Tipos uint16_t, uint8_t, ... */
+#include <stdint.h>
+#include "varredura.h"
+#include "sonar.h"
+
+#if VARREDURA_PONTOS < 2
+#error "Varredura precisa de pelo menos dois ângulos"
+#endif
+
+#if VARREDURA_ANGULO_MIN > -VARREDURA_FRENTE || VARREDURA_ANGULO_MAX < VARREDURA_FRENTE
+#error "Setor da frente fora da varredura"
+#endif
+
+/* Pulso do servo em um ângulo e variação a cada passo (contagens do
+ * Timer B2) */
+#define SERVO_PULSO(angulo) ((uint16_t)(SERVO_PULSO_CENTRO + (int32_t)(angulo) * SERVO_PULSO_90 / 90))
+#define SERVO_PULSO_PASSO   (SERVO_PULSO(VARREDURA_PASSO) - SERVO_PULSO_CENTRO)
+
+/* Contagens do Timer B2 para contagens do timer do sensor e tempo para
+ * o servo assentar em um passo */
+#define SERVO_PARA_SONAR    (8 / SONAR_DIVISOR)
+#define SERVO_ASSENTA       ((SONAR_TIMER_FREQ / 1000) * SERVO_ASSENTA_MS(VARREDURA_PASSO))
+
+/* Índices do setor da frente no mapa */
+#define FRENTE_INICIO ((-VARREDURA_ANGULO_MIN - VARREDURA_FRENTE + VARREDURA_PASSO - 1) / VARREDURA_PASSO)
+#define FRENTE_FIM    ((VARREDURA_FRENTE - VARREDURA_ANGULO_MIN) / VARREDURA_PASSO)
+
+/* Distância em mm por ângulo: escrito só pela ISR do sensor, 16 bits
+ * lidos de uma vez pelo main */
+static volatile uint16_t mapa[VARREDURA_PONTOS];
+
+/* Posição atual do servo e sentido da varredura */
+static uint8_t indice = 0;
+static uint8_t subindo = 1;
+static uint16_t pulso = SERVO_PULSO(VARREDURA_ANGULO_MIN);
+
+/* Pulso limitado à faixa do servo antes de ir para TB2CCR1: um valor
+ * pequeno demais daria um pulso cortado, grande demais forçaria o servo
+ * contra o batente */
+static inline uint16_t servo_limita(uint16_t p){
+
+    if (p < SERVO_PULSO_MIN)
+        return SERVO_PULSO_MIN;
+    if (p > SERVO_PULSO_MAX)
+        return SERVO_PULSO_MAX;
+
+    return p;
+}
+
+/* Configura o Timer B2 para o servo e o põe no primeiro ângulo */
+void varredura_init(void){
+
+    uint8_t i;
+
+    for (i = 0; i < VARREDURA_PONTOS; i++)
+        mapa[i] = SONAR_MM_INVALIDO;
+
+    indice = 0;
+    subindo = 1;
+    pulso = SERVO_PULSO(VARREDURA_ANGULO_MIN);
+
+    /* Período de 20ms e pulso em TB2.1:
+     * OUTMOD_7: reset/set, alto do início do período até CCR1
+     * CLLD_1: TB2CCR1 carregado quando TB2R volta a 0 */
+    TB2CCR0 = SERVO_PERIODO - 1;
+    TB2CCR1 = servo_limita(pulso);
+    TB2CCTL1 = OUTMOD_7 | CLLD_1;
+
+    /* Saída TB2.1 no P5.0 */
+    P5DIR |= BIT0;
+    P5SEL0 |= BIT0;
+
+    /* TBSSEL_2: SMCLK
+     * MC_1: modo up, conta até TB2CCR0
+     * ID_3: divisor 8 */
+    TB2CTL = TBSSEL_2 | MC_1 | ID_3 | TBCLR;
+}
+
+/**
+ * @brief  Guarda a medição do ângulo atual e move o servo para o
+ *         seguinte. Executado na ISR do sensor no fim da medição.
+ *
+ * @param  mm: distância medida, SONAR_MM_INVALIDO se a medição falhou.
+ *         agora: tempo atual do timer do sensor (32 bits).
+ *
+ * @retval tempo (32 bits) a partir do qual o servo está no novo ângulo.
+ */
+uint32_t varredura_passo(uint16_t mm, uint32_t agora){
+
+    uint16_t resto;
+
+    mapa[indice] = mm;
+
+    /* Vai e volta: passos sempre de um ângulo */
+    if (indice == VARREDURA_PONTOS - 1)
+        subindo = 0;
+    else if (indice == 0)
+        subindo = 1;
+
+    if (subindo){
+        indice++;
+        pulso += SERVO_PULSO_PASSO;
+    }
+    else {
+        indice--;
+        pulso -= SERVO_PULSO_PASSO;
+    }
+
+    /* Carregado no início do próximo período: o servo começa a andar
+     * em no máximo 20ms */
+    TB2CCR1 = servo_limita(pulso);
+    resto = SERVO_PERIODO - TB2R;
+
+    return agora + (uint32_t)resto * SERVO_PARA_SONAR + SERVO_ASSENTA;
+}
+
+/**
+ * @brief  Caminho mais livre: ângulo com a maior distância do mapa. Em
+ *         empate, o mais próximo da frente.
+ *
+ * @param  mm: destino da distância nesse ângulo, SONAR_MM_INVALIDO se
+ *         o mapa ainda não tem medições.
+ *
+ * @retval ângulo em graus (0: frente, negativos à esquerda).
+ */
+int16_t varredura_livre(uint16_t *mm){
+
+    int16_t angulo = VARREDURA_ANGULO_MIN;
+    int16_t melhor_angulo = 0;
+    uint16_t melhor = SONAR_MM_INVALIDO;
+    uint16_t d;
+    uint8_t i;
+
+    for (i = 0; i < VARREDURA_PONTOS; i++, angulo += VARREDURA_PASSO){
+        d = mapa[i];
+        if (d == SONAR_MM_INVALIDO)
+            continue;
+
+        if (melhor == SONAR_MM_INVALIDO || d > melhor ||
+                (d == melhor && (angulo < 0 ? -angulo : angulo) <
+                 (melhor_angulo < 0 ? -melhor_angulo : melhor_angulo))){
+            melhor = d;
+            melhor_angulo = angulo;
+        }
+    }
+
+    *mm = melhor;
+
+    return melhor_angulo;
+}
+
+/**
+ * @brief  Menor distância no setor da frente (+-VARREDURA_FRENTE graus).
+ *
+ * @retval distância em mm, SONAR_MM_INVALIDO sem medições no setor.
+ */
+uint16_t varredura_frente(void){
+
+    uint16_t menor = SONAR_MM_INVALIDO;
+    uint16_t d;
+    uint8_t i;
+
+    for (i = FRENTE_INICIO; i <= FRENTE_FIM; i++){
+        d = mapa[i];
+        if (d < menor)
+            menor = d;
+    }
+
+    return menor;
+}
+
+/**
+ * @brief  Cópia do mapa polar.
+ *
+ * @param  mm: destino com VARREDURA_PONTOS posições, do ângulo
+ *         VARREDURA_ANGULO_MIN ao VARREDURA_ANGULO_MAX.
+ *
+ * @retval none
+ */
+void varredura_mapa(uint16_t *mm){
+
+    uint8_t i;
+
+    for (i = 0; i < VARREDURA_PONTOS; i++)
+        mm[i] = mapa[i];
+}
@@ -0,0 +1,67 @@
+/*
+ *  Modulo: varredura.h
+ *
+ *  Data: 17/10/2026
+ *
+ *  Descrição: Varredura do sensor da frente com um servo: mapa polar
+ *  das distâncias por ângulo (veja varredura.c). Ligada por
+ *  SONAR_VARREDURA em hc_sr04.h.
+ */
+
+#ifndef VARREDURA_H_
+#define VARREDURA_H_
+
+#include <stdint.h>
+#include "sonar.h"
+
+/* Ângulos da varredura em graus (0: frente, negativos à esquerda) */
+#define VARREDURA_ANGULO_MIN (-60)
+#define VARREDURA_ANGULO_MAX (60)
+#define VARREDURA_PASSO      (15)
+#define VARREDURA_PONTOS     ((VARREDURA_ANGULO_MAX - VARREDURA_ANGULO_MIN) / VARREDURA_PASSO + 1)
+
+/* Setor da frente (+-graus) usado na detecção de obstáculos */
+#define VARREDURA_FRENTE     (15)
+
+/* Servo: PWM de 50Hz no Timer B2 (SMCLK / 8), pulso de 1,5ms no centro
+ * e 1ms a cada 90 graus */
+#define SERVO_FREQ           (SONAR_SMCLK_FREQ / 8)
+#define SERVO_PERIODO        (SERVO_FREQ / 50)
+#define SERVO_PULSO_CENTRO   ((SERVO_FREQ / 10000) * 15)
+#define SERVO_PULSO_90       (SERVO_FREQ / 1000)
+
+/* Faixa de pulsos aceita pelo servo (+-90 graus): nenhum pulso fora
+ * dela chega ao TB2CCR1 */
+#define SERVO_PULSO_MIN      (SERVO_PULSO_CENTRO - SERVO_PULSO_90)
+#define SERVO_PULSO_MAX      (SERVO_PULSO_CENTRO + SERVO_PULSO_90)
+
+/* Velocidade do servo (ms por 60 graus) e folga para assentar: tempo
+ * entre o novo pulso e o próximo disparo */
+#define SERVO_MS_60          (120)
+#define SERVO_FOLGA_MS       (5)
+#define SERVO_ASSENTA_MS(graus) ((graus) * SERVO_MS_60 / 60 + SERVO_FOLGA_MS)
+
+/* Espera da primeira medição: servo vindo de qualquer posição, em
+ * contagens do timer do sensor */
+#define VARREDURA_PARTIDA \
+    ((SONAR_TIMER_FREQ / 1000) * SERVO_ASSENTA_MS(VARREDURA_ANGULO_MAX - VARREDURA_ANGULO_MIN))
+
+#if SERVO_PERIODO > 0x10000
+#error "Período do servo não cabe no Timer B2"
+#endif
+
+#if VARREDURA_ANGULO_MIN < -90 || VARREDURA_ANGULO_MAX > 90
+#error "Varredura além da faixa do servo (+-90 graus)"
+#endif
+
+#if (VARREDURA_ANGULO_MAX - VARREDURA_ANGULO_MIN) % VARREDURA_PASSO
+#error "Faixa da varredura deve ser múltipla de VARREDURA_PASSO"
+#endif
+
+void varredura_init(void);
+uint32_t varredura_passo(uint16_t mm, uint32_t agora);
+int16_t varredura_livre(uint16_t *mm);
+uint16_t varredura_frente(void);
+void varredura_mapa(uint16_t *mm);
+
+#endif /* VARREDURA_H_ */